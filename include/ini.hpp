@@ -1,9 +1,14 @@
 #ifndef INIREADER_H
 #define INIREADER_H
 #include "ini_parser.hpp"
+#include <charconv>
+#include <climits>
+#include <cstdlib>
 #include <string>
 #include <string_view>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 /*
 *  String comparision functions, with case sensitive option
@@ -164,7 +169,7 @@ public:
         GetModuleFileNameA(hm, buffer, sizeof(buffer));
         std::string modulePath = buffer;
 
-        if (szFileName.find(':') != std::string_view::npos)
+        if (szFileName.find(':') != std::string_view::npos || szFileName.starts_with('/'))
         {
             m_szFileName = szFileName;
         }
@@ -182,42 +187,66 @@ public:
 
     int ReadInteger(std::string_view szSection, std::string_view szKey, int iDefaultValue)
     {
-        auto str = data.get(szSection.data(), szKey.data(), std::to_string(iDefaultValue));
-        return std::stoi(str, nullptr, starts_with(str.c_str(), "0x", false) ? 16 : 10);
+        const std::string* value = data.find_value(szSection, szKey);
+        if (!value)
+            return iDefaultValue;
+
+        // Same forms std::stoi takes: leading blanks, a sign, "0x" for hex and trailing junk
+        std::string_view str = *value;
+        while (!str.empty() && ::isspace(static_cast<unsigned char>(str.front())))
+            str.remove_prefix(1);
+
+        const bool negative = !str.empty() && str.front() == '-';
+        if (!str.empty() && (str.front() == '-' || str.front() == '+'))
+            str.remove_prefix(1);
+
+        int base = 10;
+        if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+        {
+            base = 16;
+            str.remove_prefix(2);
+        }
+
+        long long number = 0;
+        const auto result = std::from_chars(str.data(), str.data() + str.size(), number, base);
+        if (result.ec != std::errc() || number > static_cast<long long>(INT_MAX) + 1)
+            return iDefaultValue;
+
+        number = negative ? -number : number;
+        return number > INT_MAX ? iDefaultValue : static_cast<int>(number);
     }
 
     float ReadFloat(std::string_view szSection, std::string_view szKey, float fltDefaultValue)
     {
-        return (float)atof(data.get(szSection.data(), szKey.data(), std::to_string(fltDefaultValue)).c_str());
+        const std::string* value = data.find_value(szSection, szKey);
+        return value ? (float)atof(value->c_str()) : fltDefaultValue;
     }
 
     bool ReadBoolean(std::string_view szSection, std::string_view szKey, bool bolDefaultValue)
     {
-        auto val = data.get(szSection.data(), szKey.data(), "");
-        if (!val.empty())
+        const std::string* val = data.find_value(szSection, szKey);
+        if (val && !val->empty())
         {
-            if (val.size() == 1)
-                return val.front() != '0';
+            if (val->size() == 1)
+                return val->front() != '0';
             else
-                return compare(val, "false", false);
+                return compare(*val, "false", false);
         }
         return bolDefaultValue;
     }
 
     std::string ReadString(std::string_view szSection, std::string_view szKey, std::string_view szDefaultValue)
     {
-        auto s = data.get(szSection.data(), szKey.data(), szDefaultValue.data());
+        const std::string* value = data.find_value(szSection, szKey);
+        std::string_view s = value ? std::string_view(*value) : szDefaultValue;
 
-        if (!s.empty())
-        {
-            if (s.at(0) == '\"' || s.at(0) == '\'')
-                s.erase(0, 1);
+        if (!s.empty() && (s.front() == '\"' || s.front() == '\''))
+            s.remove_prefix(1);
 
-            if (s.at(s.size() - 1) == '\"' || s.at(s.size() - 1) == '\'')
-                s.erase(s.size() - 1);
-        }
+        if (!s.empty() && (s.back() == '\"' || s.back() == '\''))
+            s.remove_suffix(1);
 
-        return s;
+        return std::string(s);
     }
 
     void WriteInteger(std::string_view szSection, std::string_view szKey, int iValue, bool useparser = false)
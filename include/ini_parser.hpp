@@ -30,16 +30,214 @@
   */
 
 #include <string>       // for std::string
+#include <string_view>  // for std::basic_string_view
 #include <map>          // for std::map
 #include <cstdio>       // for std::FILE
+#include <cctype>       // for ::isspace
+#include <cstdint>      // for std::uint64_t
 #include <algorithm>    // for std::find_if
-#include <functional>   // for std::function
+#include <stdexcept>    // for std::out_of_range
+#include <utility>      // for std::pair
 #include <vector>		// for std::vector
 #include <sstream>
 #include <fstream>
 
 namespace linb
 {
+    /*
+     *  Flat container for ini sections and keys. Entries are kept in one vector
+     *  in the order they were first added, and an open addressing index of key
+     *  hashes points into it, so lookups take string views and never build a
+     *  temporary key. With CaseSensitive false keys compare ignoring ASCII case,
+     *  like GetPrivateProfileString does.
+     */
+    template<
+        class StringType,
+        class MappedType,
+        bool CaseSensitive = true
+    > class flat_ini_map
+    {
+    public:
+        typedef typename StringType::value_type                     char_type;
+        typedef std::basic_string_view<char_type>                   view_type;
+        typedef StringType                                          key_type;
+        typedef MappedType                                          mapped_type;
+        typedef std::pair<key_type, mapped_type>                    value_type;
+
+    private:
+        typedef std::vector<value_type>                             storage_type;
+
+    public:
+        typedef typename storage_type::size_type                    size_type;
+        typedef typename storage_type::difference_type              difference_type;
+        typedef typename storage_type::iterator                     iterator;
+        typedef typename storage_type::const_iterator               const_iterator;
+        typedef typename storage_type::reverse_iterator             reverse_iterator;
+        typedef typename storage_type::const_reverse_iterator       const_reverse_iterator;
+        typedef typename storage_type::reference                    reference;
+        typedef typename storage_type::const_reference              const_reference;
+        typedef typename storage_type::pointer                      pointer;
+        typedef typename storage_type::const_pointer                const_pointer;
+
+    private:
+        static constexpr size_type npos = static_cast<size_type>(-1);
+
+        storage_type entries;
+        std::vector<std::uint64_t> hashes;  // hash of entries[i].first
+        std::vector<size_type> slots;       // entry index + 1, 0 for a free slot
+
+    public:
+        iterator begin() { return entries.begin(); }
+        const_iterator begin() const { return entries.begin(); }
+        iterator end() { return entries.end(); }
+        const_iterator end() const { return entries.end(); }
+        const_iterator cbegin() const { return entries.cbegin(); }
+        const_iterator cend() const { return entries.cend(); }
+        reverse_iterator rbegin() { return entries.rbegin(); }
+        const_reverse_iterator rbegin() const { return entries.rbegin(); }
+        reverse_iterator rend() { return entries.rend(); }
+        const_reverse_iterator rend() const { return entries.rend(); }
+        const_reverse_iterator crbegin() const { return entries.crbegin(); }
+        const_reverse_iterator crend() const { return entries.crend(); }
+
+        bool empty() const { return entries.empty(); }
+        size_type size() const { return entries.size(); }
+        size_type max_size() const { return entries.max_size(); }
+
+        void clear()
+        {
+            entries.clear();
+            hashes.clear();
+            slots.clear();
+        }
+
+        mapped_type& operator[](view_type key)
+        {
+            return this->emplace(key, mapped_type()).first->second;
+        }
+        mapped_type& at(view_type key)
+        {
+            const size_type pos = lookup(key, hash_key(key));
+            if (pos == npos)
+                throw std::out_of_range("flat_ini_map::at");
+            return entries[pos].second;
+        }
+        const mapped_type& at(view_type key) const
+        {
+            const size_type pos = lookup(key, hash_key(key));
+            if (pos == npos)
+                throw std::out_of_range("flat_ini_map::at");
+            return entries[pos].second;
+        }
+
+        size_type count(view_type key) const
+        {
+            return lookup(key, hash_key(key)) != npos ? 1 : 0;
+        }
+        iterator find(view_type key)
+        {
+            const size_type pos = lookup(key, hash_key(key));
+            return pos == npos ? end() : begin() + pos;
+        }
+        const_iterator find(view_type key) const
+        {
+            const size_type pos = lookup(key, hash_key(key));
+            return pos == npos ? end() : begin() + pos;
+        }
+
+        /* Like std::map, an existing key keeps its value */
+        template<class K, class V>
+        std::pair<iterator, bool> emplace(K&& key, V&& value)
+        {
+            const view_type view(key);
+            const std::uint64_t hash = hash_key(view);
+            const size_type pos = lookup(view, hash);
+            if (pos != npos)
+                return { begin() + pos, false };
+
+            entries.emplace_back(key_type(std::forward<K>(key)), mapped_type(std::forward<V>(value)));
+            hashes.push_back(hash);
+            if (entries.size() * 4 > slots.size() * 3)
+                rehash(slots.empty() ? 16 : slots.size() * 2);
+            else
+                place(entries.size() - 1);
+            return { end() - 1, true };
+        }
+
+    private:
+        static char_type fold(char_type c)
+        {
+            if constexpr (!CaseSensitive)
+            {
+                if (c >= 'A' && c <= 'Z')
+                    return static_cast<char_type>(c - 'A' + 'a');
+            }
+            return c;
+        }
+
+        static std::uint64_t hash_key(view_type key)
+        {
+            std::uint64_t hash = 14695981039346656037ull;   // FNV-1a
+            for (char_type c : key)
+            {
+                hash ^= static_cast<std::uint64_t>(fold(c));
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        static bool equal_keys(view_type a, view_type b)
+        {
+            if constexpr (CaseSensitive)
+            {
+                return a == b;
+            }
+            else
+            {
+                if (a.size() != b.size())
+                    return false;
+                for (size_type i = 0; i < a.size(); ++i)
+                {
+                    if (fold(a[i]) != fold(b[i]))
+                        return false;
+                }
+                return true;
+            }
+        }
+
+        size_type lookup(view_type key, std::uint64_t hash) const
+        {
+            if (slots.empty())
+                return npos;
+
+            const size_type mask = slots.size() - 1;
+            for (size_type slot = static_cast<size_type>(hash) & mask; ; slot = (slot + 1) & mask)
+            {
+                const size_type entry = slots[slot];
+                if (entry == 0)
+                    return npos;
+                if (hashes[entry - 1] == hash && equal_keys(entries[entry - 1].first, key))
+                    return entry - 1;
+            }
+        }
+
+        void place(size_type pos)
+        {
+            const size_type mask = slots.size() - 1;
+            size_type slot = static_cast<size_type>(hashes[pos]) & mask;
+            while (slots[slot] != 0)
+                slot = (slot + 1) & mask;
+            slots[slot] = pos + 1;
+        }
+
+        void rehash(size_type slotCount)
+        {
+            slots.assign(slotCount, 0);
+            for (size_type pos = 0; pos < entries.size(); ++pos)
+                place(pos);
+        }
+    };
+
     template<
         class CharT = char,     /* Not compatible with other type here, since we're using C streams */
         class StringType = std::basic_string<CharT>,
@@ -74,9 +272,21 @@ namespace linb
         typedef typename section_container::pointer                 pointer;
         typedef typename section_container::const_pointer           const_pointer;
 
+        typedef std::basic_string_view<char_type>                   view_type;
+
     private:
         section_container data;
 
+        /* Containers with heterogeneous lookup are searched with the view itself */
+        template<class Container>
+        static auto find_in(Container& container, view_type key) -> decltype(container.begin())
+        {
+            if constexpr (requires { container.find(key); })
+                return container.find(key);
+            else
+                return container.find(typename Container::key_type(key));
+        }
+
     public:
 
         basic_ini()
@@ -148,13 +358,19 @@ namespace linb
         {
             return data[std::forward<string_type>(sect)];
         }
-        mapped_type& at(const string_type& sect)
+        mapped_type& at(view_type sect)
         {
-            return data.at(sect);
+            auto it = this->find(sect);
+            if (it == this->end())
+                throw std::out_of_range("basic_ini::at");
+            return it->second;
         }
-        const mapped_type& at(const string_type& sect) const
+        const mapped_type& at(view_type sect) const
         {
-            return data.at(sect);
+            auto it = this->find(sect);
+            if (it == this->end())
+                throw std::out_of_range("basic_ini::at");
+            return it->second;
         }
 
         /* Capacity information */
@@ -178,132 +394,146 @@ namespace linb
         }
 
         /* Lookup */
-        size_type count(const string_type& sect)
+        size_type count(view_type sect) const
+        {
+            return this->find(sect) != this->end() ? 1 : 0;
+        }
+        iterator find(view_type sect)
         {
-            return data.count(sect);
+            return find_in(data, sect);
         }
-        iterator find(const string_type& sect)
+        const_iterator find(view_type sect) const
         {
-            return data.find(sect);
+            return find_in(data, sect);
         }
 
-        /* Gets a value from the specified section & key, default_value is returned if the sect & key doesn't exist */
-        string_type get(const string_type& sect, const key_type& key, const string_type& default_value)
+        /* Gets the stored value of the specified section & key, nullptr if the sect & key doesn't exist */
+        const string_type* find_value(view_type sect, view_type key) const
         {
             auto it = this->find(sect);
             if (it != this->end())
             {
-                auto itv = it->second.find(key);
+                auto itv = find_in(it->second, key);
                 if (itv != it->second.end())
-                    return itv->second;
+                    return &itv->second;
             }
-            return default_value;
+            return nullptr;
+        }
+
+        /* Gets a value from the specified section & key, default_value is returned if the sect & key doesn't exist */
+        string_type get(view_type sect, view_type key, view_type default_value) const
+        {
+            const string_type* value = this->find_value(sect, key);
+            return value ? *value : string_type(default_value);
         }
 
         /* Sets the value of a value in the ini */
-        void set(const string_type& sect, const key_type& key, const string_type& value)
+        void set(view_type sect, view_type key, view_type value)
         {
-            (*this)[sect][key] = value; // no emplace since overwrite!
+            (*this)[string_type(sect)][string_type(key)] = string_type(value); // no emplace since overwrite!
         }
 
         /* Too lazy to continue this container... If you need more methods, just add it */
 
 
-        bool read_file(std::stringstream& ini_mem)
+        /*
+         *  Parses ini text held in memory. Lines are handled as views into the
+         *  buffer, only the stored section names, keys and values are copied.
+         */
+        bool read_buffer(view_type text)
         {
-            if (ini_mem.rdbuf()->in_avail())
+            if (text.empty())
+                return false;
+
+            key_container* keys = nullptr;
+            string_type null_string;
+
+            // Trims a view, ignoring any UTF-8 BOM in front of it
+            auto trim = [](view_type s, bool trimLeft, bool trimRight) -> view_type
             {
-                key_container* keys = nullptr;
-                string_type line;
-                string_type key;
-                string_type value;
-                string_type null_string;
-                size_type pos;
+                while (s.size() >= 3 && s[0] == (char)(0xEF) && s[1] == (char)(0xBB) && s[2] == (char)(0xBF))
+                    s.remove_prefix(3);
+
+                if (trimLeft)
+                    while (!s.empty() && ::isspace(static_cast<unsigned char>(s.front())))
+                        s.remove_prefix(1);
+                if (trimRight)
+                    while (!s.empty() && ::isspace(static_cast<unsigned char>(s.back())))
+                        s.remove_suffix(1);
+                return s;
+            };
+
+            // Start parsing
+            size_type offset = 0;
+            while (offset < text.size())
+            {
+                size_type end = text.find('\n', offset);
+                if (end == view_type::npos)
+                    end = text.size();
 
-                // Trims an string
-                auto trim = [](string_type& s, bool trimLeft, bool trimRight) -> string_type&
-                {
-                    if (s.size())
-                    {
-                        // Ignore UTF-8 BOM
-                        while (s.size() >= 3 && s[0] == (char)(0xEF) && s[1] == (char)(0xBB) && s[2] == (char)(0xBF))
-                            s.erase(s.begin(), s.begin() + 3);
-
-                        if (trimLeft)
-                            s.erase(s.begin(), std::find_if(s.begin(), s.end(), std::not_fn(std::function<int(int)>(::isspace))));
-                        if (trimRight)
-                            s.erase(std::find_if(s.rbegin(), s.rend(), std::not_fn(std::function<int(int)>(::isspace))).base(), s.end());
-                    }
-                    return s;
-                };
+                view_type line = text.substr(offset, end - offset);
+                offset = end + 1;
 
-                // Start parsing
-                while (std::getline(ini_mem, line))
-                {
-                    // Find comment and remove anything after it from the line
-                    if ((pos = line.find_first_of(';')) != line.npos)
-                        line.erase(pos);
+                // Find comment and remove anything after it from the line
+                size_type pos;
+                if ((pos = line.find_first_of(';')) != line.npos)
+                    line = line.substr(0, pos);
 
-                    if ((pos = line.rfind(" //")) != line.npos)
-                        line.erase(pos);
+                if ((pos = line.rfind(" //")) != line.npos)
+                    line = line.substr(0, pos);
 
-                    // Trim the string, and if it gets empty, skip this line
-                    if (trim(line, true, true).empty())
-                        continue;
+                // Trim the string, and if it gets empty, skip this line
+                line = trim(line, true, true);
+                if (line.empty())
+                    continue;
 
-                    // Find section name
-                    if (line.front() == '[' && line.back() == ']')
+                // Find section name
+                if (line.front() == '[' && line.back() == ']')
+                {
+                    keys = &data[string_type(trim(line.substr(1, line.length() - 2), true, true))];  // Create section
+                }
+                else
+                {
+                    view_type key;
+                    view_type value;
+
+                    // Find key and value positions
+                    pos = line.find_first_of('=');
+                    if (pos == line.npos)
                     {
-                        pos = line.length() - 1; //line.find_first_of(']');
-                        if (pos != line.npos)
-                        {
-                            trim(key.assign(line, 1, pos - 1), true, true);
-                            keys = &data[std::move(key)];  // Create section
-                        }
-                        else
-                            keys = nullptr;
+                        // There's only the key
+                        key = line;         // No need for trim, line is already trimmed
                     }
                     else
                     {
-                        // Find key and value positions
-                        pos = line.find_first_of('=');
-                        if (pos == line.npos)
-                        {
-                            // There's only the key
-                            key = line;         // No need for trim, line is already trimmed
-                            value.clear();
-                        }
-                        else
-                        {
-                            // There's the key and the value
-                            trim(key.assign(line, 0, pos), false, true);                  // trim the right
-                            trim(value.assign(line, pos + 1, line.npos), true, false);    // trim the left
-                        }
-
-                        // Put the key/value into the current keys object, or into the section "" if no section has been found
-#if __cplusplus >= 201103L || _MSC_VER >= 1800
-                        (keys ? *keys : data[null_string]).emplace(std::move(key), std::move(value));
-#else
-                        (keys ? *keys : data[null_string])[key] = value;
-                        key.clear(); value.clear();
-#endif
+                        // There's the key and the value
+                        key = trim(line.substr(0, pos), false, true);       // trim the right
+                        value = trim(line.substr(pos + 1), true, false);    // trim the left
                     }
-                }
 
-                return true;
+                    // Put the key/value into the current keys object, or into the section "" if no section has been found
+                    (keys ? *keys : data[null_string]).emplace(key, value);
+                }
             }
-            return false;
+
+            return true;
+        }
+
+        bool read_file(std::stringstream& ini_mem)
+        {
+            return read_buffer(ini_mem.str());
         }
 
         bool read_file(const char_type* filename)
         {
-            std::ifstream file(filename, std::ios::in);
+            // One bulk read instead of streaming the file through a stringstream
+            std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
             if (file.is_open())
             {
-                std::stringstream ss;
-                ss << file.rdbuf();
-                file.close();
-                return read_file(ss);
+                string_type content(static_cast<size_type>(file.tellg()), char_type());
+                file.seekg(0);
+                file.read(&content[0], static_cast<std::streamsize>(content.size()));
+                return read_buffer(content);
             }
             return false;
         }
@@ -313,25 +543,37 @@ namespace linb
          */
         bool write_file(const char_type* filename)
         {
-            FILE* f;
-            errno_t err;
-            if ((err = fopen_s(&f, filename, "w")) == 0)
+            // Built in memory first and written with a single call
+            string_type out;
+            bool first = true;
+            for (auto& sec : this->data)
             {
-                bool first = true;
-                for (auto& sec : this->data)
+                if (!first)
+                    out += '\n';
+                first = false;
+
+                out += '[';
+                out += sec.first;
+                out += "]\n";
+                for (auto& kv : sec.second)
                 {
-                    fprintf(f, first ? "[%s]\n" : "\n[%s]\n", sec.first.c_str());
-                    first = false;
-                    for (auto& kv : sec.second)
+                    out += kv.first;
+                    if (!kv.second.empty())
                     {
-                        if (kv.second.empty())
-                            fprintf(f, "%s\n", kv.first.c_str());
-                        else
-                            fprintf(f, "%s = %s\n", kv.first.c_str(), kv.second.c_str());
+                        out += " = ";
+                        out += kv.second;
                     }
+                    out += '\n';
                 }
+            }
+
+            FILE* f;
+            errno_t err;
+            if ((err = fopen_s(&f, filename, "w")) == 0)
+            {
+                const bool written = fwrite(out.data(), sizeof(char_type), out.size(), f) == out.size();
                 fclose(f);
-                return true;
+                return written;
             }
             return false;
         }
@@ -365,10 +607,19 @@ namespace linb
      *
      *  Limitations:
      *      * Not unicode aware
-     *      * Case sensitive
+     *      * Case sensitive (see ini_nocase)
      *      * Sections must have unique keys
+     *      * Sections and keys are iterated in file order, not sorted like
+     *        std::map; a repeated key keeps its first value
      */
-    typedef basic_ini<>     ini;
+    typedef basic_ini<char, std::string,
+        flat_ini_map<std::string, std::string>,
+        flat_ini_map<std::string, flat_ini_map<std::string, std::string>>>   ini;
+
+    /* Same as ini, but section and key names ignore ASCII case */
+    typedef basic_ini<char, std::string,
+        flat_ini_map<std::string, std::string, false>,
+        flat_ini_map<std::string, flat_ini_map<std::string, std::string, false>, false>>   ini_nocase;
 }
 
 #endif
\ No newline at end of file
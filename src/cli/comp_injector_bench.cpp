@@ -0,0 +1,694 @@
+#include "pch.h"
+#include "line_pipeline.h"
+#include "line_reader.h"
+#include "record_schema.h"
+#include "text_utils.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+std::filesystem::path gGameRoot;
+std::filesystem::path gPluginDir;
+
+namespace
+{
+    // Byte-at-a-time versions of the Text helpers, with the same whitespace
+    // and ASCII case rules. They are what the loaders used before the shared
+    // module, and the reference its vector paths are checked against.
+    namespace Scalar
+    {
+        bool IsSpace(char ch)
+        {
+            return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+        }
+
+        char LowerChar(char ch)
+        {
+            return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + ('a' - 'A')) : ch;
+        }
+
+        char UpperChar(char ch)
+        {
+            return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - ('a' - 'A')) : ch;
+        }
+
+        size_t FindFirstNonSpace(std::string_view text, size_t from = 0)
+        {
+            for (size_t i = from; i < text.size(); ++i)
+            {
+                if (!IsSpace(text[i]))
+                {
+                    return i;
+                }
+            }
+            return Text::npos;
+        }
+
+        size_t FindLastNonSpace(std::string_view text)
+        {
+            for (size_t i = text.size(); i > 0; --i)
+            {
+                if (!IsSpace(text[i - 1]))
+                {
+                    return i - 1;
+                }
+            }
+            return Text::npos;
+        }
+
+        size_t FindChar(std::string_view text, char ch, size_t from = 0)
+        {
+            for (size_t i = from; i < text.size(); ++i)
+            {
+                if (text[i] == ch)
+                {
+                    return i;
+                }
+            }
+            return Text::npos;
+        }
+
+        std::string_view Trim(std::string_view text)
+        {
+            const size_t first = FindFirstNonSpace(text);
+            return first == Text::npos ? std::string_view() : text.substr(first, FindLastNonSpace(text) - first + 1);
+        }
+
+        bool EqualsIgnoreCase(std::string_view left, std::string_view right)
+        {
+            if (left.size() != right.size())
+            {
+                return false;
+            }
+            for (size_t i = 0; i < left.size(); ++i)
+            {
+                if (LowerChar(left[i]) != LowerChar(right[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::string ToLower(std::string_view text)
+        {
+            std::string result(text);
+            for (char& ch : result)
+            {
+                ch = LowerChar(ch);
+            }
+            return result;
+        }
+
+        std::string ToUpper(std::string_view text)
+        {
+            std::string result(text);
+            for (char& ch : result)
+            {
+                ch = UpperChar(ch);
+            }
+            return result;
+        }
+
+        bool IsCommentOrEmpty(std::string_view line)
+        {
+            const size_t first = FindFirstNonSpace(line);
+            if (first == Text::npos)
+            {
+                return true;
+            }
+            line.remove_prefix(first);
+            return line.front() == ';' || line.front() == '#' || line.starts_with("//");
+        }
+    }
+
+    // Bytes the vector paths treat specially, plus the neighbours of every
+    // range they test and bytes with the high bit set.
+    constexpr char kAlphabet[] = {
+        ' ', '\t', '\r', '\n', '\v', '\f', '=', ';', '#', '/', '[', ']',
+        '@', 'A', 'M', 'Z', '[', '`', 'a', 'm', 'z', '{', '0', '9',
+        static_cast<char>(0x80), static_cast<char>(0xC1), static_cast<char>(0xDA), static_cast<char>(0xFF),
+    };
+
+    std::string RandomText(std::mt19937& random, size_t length, int spaceBias)
+    {
+        std::uniform_int_distribution<size_t> pick(0, sizeof(kAlphabet) - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::string text(length, ' ');
+        for (char& ch : text)
+        {
+            if (percent(random) >= spaceBias)
+            {
+                ch = kAlphabet[pick(random)];
+            }
+        }
+        return text;
+    }
+
+    class CChecker
+    {
+    public:
+        template <typename T>
+        void Expect(const char* what, const T& actual, const T& expected, std::string_view input)
+        {
+            ++checks;
+            if (actual == expected)
+            {
+                return;
+            }
+
+            if (++failures <= 10)
+            {
+                std::cerr << "MISMATCH " << what << " on a " << input.size() << " byte input\n";
+            }
+        }
+
+        size_t GetChecks() const { return checks; }
+        size_t GetFailures() const { return failures; }
+
+    private:
+        size_t checks = 0;
+        size_t failures = 0;
+    };
+
+    // Every length across several vector widths, every start offset within
+    // a block and both mostly blank and mostly dense text, so each vector
+    // path and its scalar tail run against the reference.
+    void CheckText(CChecker& checker)
+    {
+        std::mt19937 random(12345);
+        for (int round = 0; round < 40; ++round)
+        {
+            for (size_t length = 0; length <= 3 * 32 + 7; ++length)
+            {
+                const int spaceBias = round % 2 == 0 ? 90 : 20;
+                const std::string text = RandomText(random, length + 32, spaceBias);
+                for (size_t offset = 0; offset < 32; offset += 7)
+                {
+                    const std::string_view view = std::string_view(text).substr(offset, length);
+
+                    checker.Expect("FindFirstNonSpace", Text::FindFirstNonSpace(view), Scalar::FindFirstNonSpace(view), view);
+                    checker.Expect("FindFirstNonSpace(from)", Text::FindFirstNonSpace(view, length / 2), Scalar::FindFirstNonSpace(view, length / 2), view);
+                    checker.Expect("FindLastNonSpace", Text::FindLastNonSpace(view), Scalar::FindLastNonSpace(view), view);
+                    checker.Expect("Trim", Text::Trim(view), Scalar::Trim(view), view);
+                    checker.Expect("IsCommentOrEmpty", Text::IsCommentOrEmpty(view), Scalar::IsCommentOrEmpty(view), view);
+                    checker.Expect("ToLower", Text::ToLower(view), Scalar::ToLower(view), view);
+                    checker.Expect("ToUpper", Text::ToUpper(view), Scalar::ToUpper(view), view);
+                    for (char ch : { '=', ';', ' ', static_cast<char>(0xFF) })
+                    {
+                        checker.Expect("FindChar", Text::FindChar(view, ch), Scalar::FindChar(view, ch), view);
+                        checker.Expect("FindChar(from)", Text::FindChar(view, ch, length / 3), Scalar::FindChar(view, ch, length / 3), view);
+                    }
+
+                    // Equal up to case, then one byte changed at every position.
+                    std::string other = round % 4 < 2 ? Scalar::ToUpper(view) : Scalar::ToLower(view);
+                    checker.Expect("EqualsIgnoreCase", Text::EqualsIgnoreCase(view, other), Scalar::EqualsIgnoreCase(view, other), view);
+                    for (size_t i = 0; i < other.size(); ++i)
+                    {
+                        const char saved = other[i];
+                        other[i] = kAlphabet[(i + static_cast<size_t>(round)) % sizeof(kAlphabet)];
+                        checker.Expect("EqualsIgnoreCase", Text::EqualsIgnoreCase(view, other), Scalar::EqualsIgnoreCase(view, other), view);
+                        other[i] = saved;
+                    }
+                }
+            }
+        }
+    }
+
+    // A ModelVariations style file: sections, keys, comments and blank
+    // lines, with the indentation and line endings the real ones have.
+    std::string MakeIniText(size_t lines)
+    {
+        std::mt19937 random(6789);
+        std::uniform_int_distribution<int> kind(0, 9);
+        std::string text;
+        for (size_t i = 0; i < lines; ++i)
+        {
+            switch (kind(random))
+            {
+            case 0:
+                text += "[SECTION" + std::to_string(i) + "]\r\n";
+                break;
+            case 1:
+                text += "; comment line " + std::to_string(i) + "\r\n";
+                break;
+            case 2:
+                text += "   \t\r\n";
+                break;
+            default:
+                text += "    Key" + std::to_string(i % 97) + "  =  model" + std::to_string(i) + ", MODEL" + std::to_string(i + 1) + "   \r\n";
+                break;
+            }
+        }
+        return text;
+    }
+
+    // The loop the loaders ran before they were built on LinePipeline.
+    std::vector<std::string_view> HandLoopLines(std::string_view data)
+    {
+        std::vector<std::string_view> lines;
+        CLineReader reader(data);
+        std::string_view line;
+        while (reader.Next(line))
+        {
+            if (!Text::IsCommentOrEmpty(line))
+            {
+                lines.push_back(Text::Trim(line));
+            }
+        }
+        return lines;
+    }
+
+    std::vector<std::string_view> PipelineLines(std::string_view data)
+    {
+        std::vector<std::string_view> lines;
+        for (std::string_view line : LinePipeline::TrimLines(LinePipeline::StripComments(LinePipeline::SplitLines(data))))
+        {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    void CheckPipeline(CChecker& checker)
+    {
+        for (const size_t lines : { 0, 1, 7, 1000 })
+        {
+            const std::string text = MakeIniText(lines);
+            checker.Expect("LinePipeline", PipelineLines(text), HandLoopLines(text), text);
+
+            // Without the final line break, and with bare '\n' endings.
+            const std::string_view cut = std::string_view(text).substr(0, text.empty() ? 0 : text.size() - 2);
+            checker.Expect("LinePipeline", PipelineLines(cut), HandLoopLines(cut), cut);
+
+            std::string unix;
+            for (char ch : text)
+            {
+                if (ch != '\r')
+                {
+                    unix += ch;
+                }
+            }
+            checker.Expect("LinePipeline", PipelineLines(unix), HandLoopLines(unix), unix);
+        }
+    }
+
+    // Runs body iterations times and prints nanoseconds per item. The sum
+    // the body returns keeps the compiler from dropping the work.
+    template <typename Body>
+    double Time(size_t iterations, size_t itemsPerIteration, Body body)
+    {
+        size_t sink = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            sink += body();
+        }
+        const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        static volatile size_t keep = 0;
+        keep = keep + sink;
+        return elapsed / static_cast<double>(iterations * itemsPerIteration);
+    }
+
+    void Report(const char* name, double before, double after)
+    {
+        std::cout << "  " << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << before << std::setw(10) << after << std::setw(9) << before / after << "x\n";
+    }
+
+    void BenchText(size_t iterations)
+    {
+        // Lines as the loaders see them: indented keys with padded values,
+        // comment lines and long model lists.
+        std::vector<std::string> lines;
+        std::mt19937 random(42);
+        for (size_t i = 0; i < 4096; ++i)
+        {
+            const size_t indent = i % 3 == 0 ? 24 : 4;
+            std::string line(indent, ' ');
+            line += i % 5 == 0 ? "; " : "";
+            line += "Peds = " + RandomText(random, 8 + i % 120, 0) + "    \t ";
+            lines.push_back(std::move(line));
+        }
+
+        std::vector<std::string> upper;
+        for (const auto& line : lines)
+        {
+            upper.push_back(Scalar::ToUpper(line));
+        }
+
+        const size_t count = lines.size();
+        std::cout << "text helpers, ns per line (" << count << " lines x " << iterations << ")\n";
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(10) << "scalar" << std::setw(10) << "Text::" << std::setw(10) << "speedup" << "\n";
+
+        Report("Trim",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : lines) n += Scalar::Trim(l).size(); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : lines) n += Text::Trim(l).size(); return n; }));
+        Report("IsCommentOrEmpty",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : lines) n += Scalar::IsCommentOrEmpty(l); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : lines) n += Text::IsCommentOrEmpty(l); return n; }));
+        Report("FindChar '='",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : lines) n += Scalar::FindChar(l, '='); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : lines) n += Text::FindChar(l, '='); return n; }));
+        Report("EqualsIgnoreCase",
+            Time(iterations, count, [&]() { size_t n = 0; for (size_t i = 0; i < count; ++i) n += Scalar::EqualsIgnoreCase(lines[i], upper[i]); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (size_t i = 0; i < count; ++i) n += Text::EqualsIgnoreCase(lines[i], upper[i]); return n; }));
+        Report("ToLower",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : upper) n += Scalar::ToLower(l).size(); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : upper) n += Text::ToLower(l).size(); return n; }));
+    }
+
+    void BenchPipeline(size_t iterations)
+    {
+        const std::string text = MakeIniText(20000);
+        const size_t count = 20000;
+        std::cout << "line pipeline, ns per line (" << count << " lines x " << iterations << ")\n";
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(10) << "loop" << std::setw(10) << "pipeline" << std::setw(10) << "ratio" << "\n";
+
+        Report("split, strip, trim",
+            Time(iterations, count, [&]()
+                {
+                    size_t n = 0;
+                    CLineReader reader(text);
+                    std::string_view line;
+                    while (reader.Next(line))
+                    {
+                        if (!Text::IsCommentOrEmpty(line))
+                        {
+                            n += Text::Trim(line).size();
+                        }
+                    }
+                    return n;
+                }),
+            Time(iterations, count, [&]()
+                {
+                    size_t n = 0;
+                    for (std::string_view line : LinePipeline::TrimLines(LinePipeline::StripComments(LinePipeline::SplitLines(text))))
+                    {
+                        n += line.size();
+                    }
+                    return n;
+                }));
+    }
+
+    // The sscanf and istringstream parsers the audio, weapon and train
+    // loaders used before CRecordSchema, as they were written there.
+    namespace Legacy
+    {
+        bool IsAudioRecord(const std::string& line)
+        {
+            char name[256] = {};
+            int vehAudType = 0, playerBank = 0, dummyBank = 0, bassSetting = 0, hornType = 0;
+            int doorType = 0, engineUpgrade = 0, radioStation = 0, radioType = 0, audioTypeForName = 0;
+            float bassFactor = 0.0f, enginePitch = 0.0f, hornPitch = 0.0f, engineVolumeOffset = 0.0f;
+            int count = sscanf(line.c_str(),
+                "%255s %d %d %d %d %f %f %d %f %d %d %d %d %d %f",
+                name, &vehAudType, &playerBank, &dummyBank, &bassSetting, &bassFactor, &enginePitch,
+                &hornType, &hornPitch, &doorType, &engineUpgrade, &radioStation, &radioType,
+                &audioTypeForName, &engineVolumeOffset);
+
+            return count == 15 && strnlen(name, sizeof(name)) > 0;
+        }
+
+        bool IsWeaponRecord(const std::string& line)
+        {
+            int index = 0, ammoClip = 0, damage = 0, accuracy = 0, flags = 0, animGroup = 0, modelId1 = 0, modelId2 = 0;
+            char name[256] = {};
+            float range = 0.0f;
+            int count = sscanf(line.c_str(), "%d %255s %d %d %d %d %d %d %d %f",
+                &index, name, &ammoClip, &damage, &accuracy, &flags, &animGroup, &modelId1, &modelId2, &range);
+
+            return count == 10 && strnlen(name, sizeof(name)) > 0;
+        }
+
+        bool IsTrainRecord(const std::string& line)
+        {
+            std::istringstream stream(line);
+            int trainType = 0;
+            if (!(stream >> trainType))
+            {
+                return false;
+            }
+
+            std::string carriage;
+            int count = 0;
+            while (stream >> carriage)
+            {
+                ++count;
+                if (count > 12)
+                {
+                    break;
+                }
+            }
+            return count >= 1 && count <= 12;
+        }
+    }
+
+    // Same layouts as the loaders declare.
+    using AudioRecord = CRecordSchema<RecordField::Token,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Int,
+        RecordField::Float, RecordField::Float, RecordField::Int, RecordField::Float,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Int,
+        RecordField::Int, RecordField::Float>;
+    using WeaponRecord = CRecordSchema<RecordField::Int, RecordField::Token,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Int,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Float>;
+    using TrainRecord = CRecordSchema<RecordField::Int, RecordField::Tokens<1, 12>>;
+
+    // Field layouts for the generator: 't' token, 'i' int, 'f' float and
+    // 'r' one to twelve trailing tokens.
+    constexpr const char* kAudioLayout = "tiiiiffifiiiiif";
+    constexpr const char* kWeaponLayout = "itiiiiiiif";
+    constexpr const char* kTrainLayout = "ir";
+
+    std::string RandomField(std::mt19937& random, char kind)
+    {
+        std::uniform_int_distribution<int> number(-1000, 100000);
+        switch (kind)
+        {
+        case 'i':
+            return std::to_string(number(random));
+        case 'f':
+            return number(random) % 3 == 0 ? std::to_string(number(random) % 10) : std::to_string(number(random) % 100) + "." + std::to_string(number(random) % 1000 + 1000).substr(1);
+        case 'r':
+        {
+            std::string tokens = "car" + std::to_string(number(random) % 50);
+            for (int i = number(random) % 12; i > 0; --i)
+            {
+                tokens += " car" + std::to_string(number(random) % 50);
+            }
+            return tokens;
+        }
+        default:
+            return "name" + std::to_string(number(random) % 1000);
+        }
+    }
+
+    struct RecordCorpus
+    {
+        std::vector<std::string> wellFormed;
+        std::vector<std::string> all;
+    };
+
+    // Well-formed records in the whitespace the data files use, and damaged
+    // copies: a field missing, a field added, numbers with trailing text,
+    // a float where an int goes, words where numbers go and comment lines.
+    RecordCorpus MakeRecordCorpus(const char* layout, size_t records)
+    {
+        std::mt19937 random(2024);
+        std::uniform_int_distribution<int> pick(0, 7);
+        RecordCorpus corpus;
+        const std::string_view fields = layout;
+        for (size_t i = 0; i < records; ++i)
+        {
+            std::vector<std::string> values;
+            for (char kind : fields)
+            {
+                values.push_back(RandomField(random, kind));
+            }
+
+            const auto join = [&](const std::vector<std::string>& parts)
+            {
+                std::string line = i % 4 == 0 ? "\t" : "";
+                for (size_t k = 0; k < parts.size(); ++k)
+                {
+                    line += (k == 0 ? "" : (i % 3 == 0 ? "\t" : "   ")) + parts[k];
+                }
+                return line + (i % 2 == 0 ? "\r" : "");
+            };
+
+            const std::string line = join(values);
+            corpus.wellFormed.push_back(line);
+            corpus.all.push_back(line);
+
+            std::vector<std::string> damaged = values;
+            const size_t at = i % values.size();
+            switch (pick(random))
+            {
+            case 0:
+                damaged.pop_back();
+                break;
+            case 1:
+                damaged.push_back("extra");
+                break;
+            case 2:
+                damaged[at] += ",";
+                break;
+            case 3:
+                damaged[at] += "abc";
+                break;
+            case 4:
+                damaged[at] = "1.5";
+                break;
+            case 5:
+                damaged[at] = "none";
+                break;
+            case 6:
+                damaged.insert(damaged.begin(), ";");
+                break;
+            default:
+                damaged.assign(1, "99999999999");
+                break;
+            }
+            corpus.all.push_back(join(damaged));
+        }
+        return corpus;
+    }
+
+    // The schemas are stricter than the parsers they replaced: numbers have
+    // to be whole tokens. So every well-formed record has to pass both,
+    // nothing may pass the schema alone, and the lines only the old parser
+    // took are counted.
+    template <typename Schema>
+    void CheckRecords(CChecker& checker, const char* name, const char* layout, bool (*legacy)(const std::string&))
+    {
+        const RecordCorpus corpus = MakeRecordCorpus(layout, 2000);
+        for (const auto& line : corpus.wellFormed)
+        {
+            checker.Expect(name, Schema::Matches(line), true, line);
+            checker.Expect(name, legacy(line), true, line);
+        }
+
+        size_t both = 0;
+        size_t legacyOnly = 0;
+        for (const auto& line : corpus.all)
+        {
+            const bool schema = Schema::Matches(line);
+            const bool old = legacy(line);
+            checker.Expect(name, schema && !old, false, line);
+            both += schema && old;
+            legacyOnly += old && !schema;
+        }
+
+        std::cout << "  " << std::left << std::setw(8) << name << std::right << corpus.all.size() << " lines, " << both
+            << " accepted by both, " << legacyOnly << " only by the old parser (partial numbers)\n";
+    }
+
+    void BenchRecords(size_t iterations)
+    {
+        const RecordCorpus audio = MakeRecordCorpus(kAudioLayout, 2000);
+        const RecordCorpus weapon = MakeRecordCorpus(kWeaponLayout, 2000);
+        const RecordCorpus train = MakeRecordCorpus(kTrainLayout, 2000);
+        const size_t count = audio.all.size();
+
+        std::cout << "record validation, ns per line (" << count << " lines x " << iterations << ")\n";
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(10) << "old" << std::setw(10) << "schema" << std::setw(10) << "speedup" << "\n";
+
+        Report("audio (sscanf)",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : audio.all) n += Legacy::IsAudioRecord(l); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : audio.all) n += AudioRecord::Matches(l); return n; }));
+        Report("weapon (sscanf)",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : weapon.all) n += Legacy::IsWeaponRecord(l); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : weapon.all) n += WeaponRecord::Matches(l); return n; }));
+        Report("train (istringstream)",
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : train.all) n += Legacy::IsTrainRecord(l); return n; }),
+            Time(iterations, count, [&]() { size_t n = 0; for (const auto& l : train.all) n += TrainRecord::Matches(l); return n; }));
+
+        // The FLA loaders classify a line once and test it against every
+        // schema they know.
+        Report("all three on one line",
+            Time(iterations, count, [&]()
+                {
+                    size_t n = 0;
+                    for (const auto& l : weapon.all)
+                    {
+                        n += Legacy::IsAudioRecord(l) + Legacy::IsWeaponRecord(l) + Legacy::IsTrainRecord(l);
+                    }
+                    return n;
+                }),
+            Time(iterations, count, [&]()
+                {
+                    size_t n = 0;
+                    for (const auto& l : weapon.all)
+                    {
+                        const CRecordLine line(l);
+                        n += AudioRecord::Matches(line) + WeaponRecord::Matches(line) + TrainRecord::Matches(line);
+                    }
+                    return n;
+                }));
+    }
+
+    void PrintUsage()
+    {
+        std::cerr << "usage: comp_injector_bench [--check] [--iterations <count>]\n"
+            << "\n"
+            << "Checks the vectorized text helpers, the line pipeline and the record\n"
+            << "schemas against the plain loops and sscanf parsers they replaced, on\n"
+            << "generated input, then times both. --check only runs the checks.\n"
+            << "The exit code is 1 when any check failed.\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool checkOnly = false;
+    size_t iterations = 200;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--check")
+        {
+            checkOnly = true;
+        }
+        else if (arg == "--iterations" && i + 1 < argc)
+        {
+            iterations = std::max<size_t>(1, static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    CChecker checker;
+    CheckText(checker);
+    CheckPipeline(checker);
+    CheckRecords<AudioRecord>(checker, "audio", kAudioLayout, Legacy::IsAudioRecord);
+    CheckRecords<WeaponRecord>(checker, "weapon", kWeaponLayout, Legacy::IsWeaponRecord);
+    CheckRecords<TrainRecord>(checker, "train", kTrainLayout, Legacy::IsTrainRecord);
+    std::cout << checker.GetChecks() << " checks, " << checker.GetFailures() << " failed\n";
+    if (checker.GetFailures() > 0)
+    {
+        return 1;
+    }
+
+    if (checkOnly)
+    {
+        return 0;
+    }
+
+    BenchText(iterations);
+    BenchPipeline(iterations / 10 + 1);
+    BenchRecords(iterations / 10 + 1);
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "pch.h"
+#include "loader/loader_core.h"
+#include "loader/run_manifest.h"
+#include "dir_watcher.h"
+#include "logger.h"
+#include "task_pool.h"
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+std::filesystem::path gGameRoot;
+std::filesystem::path gPluginDir;
+
+namespace
+{
+    void PrintUsage()
+    {
+        std::cerr << "usage: comp_injector_cli <game folder> [--plugin-dir <folder>] [--threads <count>] [--watch [--debounce <ms>]]\n"
+            << "\n"
+            << "Runs the COMP.Injector pipeline against an installed game, so the plugin\n"
+            << "only has to verify the outputs on the next launch. The plugin folder holds\n"
+            << MODNAME_EXT << ", COMP.Injector.ini and the reference baselines; it defaults to\n"
+            << "the game folder, or its scripts folder when the plugin lives there.\n"
+            << "\n"
+            << "--watch keeps running and regenerates the outputs affected by every change\n"
+            << "to modloader, the reference folder or COMP.Injector.ini, once no further\n"
+            << "change arrived for --debounce milliseconds (default 300).\n"
+            << "\n"
+            << "The exit code is 1 when the run failed; nothing of it is saved then.\n";
+    }
+
+    std::filesystem::path FindPluginDir(const std::filesystem::path& gameRoot)
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(gameRoot / MODNAME_EXT, ec) && std::filesystem::exists(gameRoot / "scripts" / MODNAME_EXT, ec))
+        {
+            return gameRoot / "scripts";
+        }
+        return gameRoot;
+    }
+
+    bool EqualsNoCase(const std::string& left, const std::string& right)
+    {
+        return left.size() == right.size() && _stricmp(left.c_str(), right.c_str()) == 0;
+    }
+
+    // modloader keeps its own state in hidden folders such as .data.
+    bool IsInHiddenFolder(const std::filesystem::path& path, const std::filesystem::path& root)
+    {
+        for (const auto& part : path.lexically_relative(root))
+        {
+            const std::string name = part.string();
+            if (name.size() > 1 && name[0] == '.' && name != "..")
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int Watch(CompInjector& injector, int debounceMs)
+    {
+        const std::filesystem::path modloaderRoot = GAME_PATH((char*)"modloader");
+        const std::filesystem::path referenceDir = GetInjectorBasePath("gta.dat").parent_path();
+        const std::filesystem::path configPath = gConfig.GetIniPath();
+
+        CDirWatcher watcher;
+        const std::pair<std::filesystem::path, bool> folders[] = {
+            { modloaderRoot, true },
+            { referenceDir, false },
+            { gPluginDir, false },
+        };
+        for (const auto& [folder, recursive] : folders)
+        {
+            if (const std::error_code ec = watcher.Add(folder, recursive))
+            {
+                std::cerr << "Cannot watch " << folder.string() << ": " << ec.message() << "\n";
+            }
+        }
+
+        std::cout << "Watching for changes, press Ctrl+C to stop." << std::endl;
+
+        std::vector<DirChange> changes;
+        while (true)
+        {
+            changes.clear();
+            if (const std::error_code ec = watcher.Wait(-1, changes))
+            {
+                std::cerr << "Watch failed: " << ec.message() << "\n";
+                return 1;
+            }
+
+            // Editors and copy tools touch files several times in a row, wait
+            // until the burst is over.
+            size_t seen = 0;
+            while (seen != changes.size())
+            {
+                seen = changes.size();
+                if (const std::error_code ec = watcher.Wait(debounceMs, changes))
+                {
+                    std::cerr << "Watch failed: " << ec.message() << "\n";
+                    return 1;
+                }
+            }
+
+            unsigned stages = 0;
+            size_t relevant = 0;
+            bool configChanged = false;
+            for (const auto& change : changes)
+            {
+                // The plugin folder is only watched for the config and the .inj
+                // files, the log and cache next to them change on every refresh.
+                if (change.path.parent_path() == gPluginDir)
+                {
+                    if (EqualsNoCase(change.path.filename().string(), configPath.filename().string()))
+                    {
+                        configChanged = true;
+                        stages |= StageAll;
+                    }
+                    else if (EqualsNoCase(change.path.extension().string(), ".inj"))
+                    {
+                        stages |= StageInj;
+                    }
+                    continue;
+                }
+
+                // Files written by the previous refresh would trigger the next one.
+                if (IsInHiddenFolder(change.path, modloaderRoot) || RunManifest.IsOutput(change.path))
+                {
+                    continue;
+                }
+
+                // A file no stage claims still counts: any name can be an INJ
+                // target, and Refresh() finds out which stages have to run.
+                stages |= CompInjector::GetAffectedStages(change.path, change.isDirectory);
+                ++relevant;
+            }
+
+            if (stages == 0 && relevant == 0)
+            {
+                continue;
+            }
+
+            if (configChanged)
+            {
+                gConfig = CIniReader(configPath.string());
+            }
+
+            Logger.Log("WATCH: " + std::to_string(changes.size()) + " changes, refreshing.");
+            injector.Refresh(stages);
+            if (injector.HasFailed())
+            {
+                std::cerr << "Refresh failed after " << changes.size() << " changes, nothing saved. See the log." << std::endl;
+                continue;
+            }
+            std::cout << "Refreshed after " << changes.size() << " changes." << std::endl;
+
+            // The point of refreshing here is that the game finds nothing to do.
+            if (!injector.IsSavedRunCurrent())
+            {
+                Logger.Log("WATCH: the saved run is not current, the game will regenerate outputs on the next launch.");
+                std::cout << "Warning: the saved run is not current, the game will regenerate outputs on the next launch." << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path gameRoot;
+    std::filesystem::path pluginDir;
+    size_t workerThreads = std::thread::hardware_concurrency();
+    bool watch = false;
+    int debounceMs = 300;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--plugin-dir" && i + 1 < argc)
+        {
+            pluginDir = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            workerThreads = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--watch")
+        {
+            watch = true;
+        }
+        else if (arg == "--debounce" && i + 1 < argc)
+        {
+            debounceMs = std::atoi(argv[++i]);
+        }
+        else if (!arg.starts_with("-") && gameRoot.empty())
+        {
+            gameRoot = argv[i];
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    std::error_code ec;
+    if (gameRoot.empty() || !std::filesystem::is_directory(gameRoot, ec))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    // Absolute paths, so the run manifest matches the one the plugin computes in game.
+    gGameRoot = std::filesystem::absolute(gameRoot, ec);
+    gPluginDir = std::filesystem::absolute(pluginDir.empty() ? FindPluginDir(gGameRoot) : pluginDir, ec);
+
+    gConfig.SetIniPath((gPluginDir / "COMP.Injector.ini").string());
+
+    // Unlike DllMain there is no loader lock here, worker threads start right away.
+    CompInjector injector(gPluginDir / MODNAME_EXT, workerThreads);
+
+    const std::string logPath = (gPluginDir / "comp.injector.log").string();
+    if (injector.HasFailed())
+    {
+        std::cerr << "Run failed, nothing saved. See " << logPath << "\n";
+        return 1;
+    }
+
+    std::cout << (injector.IsUpToDate() ? "Outputs already current." : "Outputs updated.") << " See " << logPath << "\n";
+
+    if (!watch)
+    {
+        return 0;
+    }
+
+    // The constructor stops the pool once the first run is done.
+    TaskPool.Start(workerThreads);
+    return Watch(injector, debounceMs);
+}
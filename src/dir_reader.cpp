@@ -0,0 +1,286 @@
+#include "pch.h"
+#include "dir_reader.h"
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+    // Layout of the records returned by getdents64.
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    constexpr size_t kBufferSize = 64 * 1024;
+
+    int64_t ToNanoseconds(const struct timespec& time)
+    {
+        return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+#else
+    int64_t ToTicks(const FILETIME& time)
+    {
+        return (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    bool IsDotEntry(const wchar_t* name)
+    {
+        return name[0] == L'.' && (name[1] == L'\0' || (name[1] == L'.' && name[2] == L'\0'));
+    }
+#endif
+}
+
+CDirReader::~CDirReader()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+std::error_code CDirReader::Open(const std::filesystem::path& dir, bool withAttributes)
+{
+    Close();
+    error.clear();
+    attributes = withAttributes;
+
+    const std::wstring pattern = (dir / L"*").wstring();
+    handle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        const DWORD lastError = GetLastError();
+        if (lastError != ERROR_FILE_NOT_FOUND)
+        {
+            error = std::error_code(static_cast<int>(lastError), std::system_category());
+        }
+        return error;
+    }
+
+    hasPending = true;
+    return error;
+}
+
+bool CDirReader::Next(DirEntryView& entry)
+{
+    while (handle != INVALID_HANDLE_VALUE)
+    {
+        if (!hasPending)
+        {
+            if (!FindNextFileW(handle, &findData))
+            {
+                const DWORD lastError = GetLastError();
+                if (lastError != ERROR_NO_MORE_FILES)
+                {
+                    error = std::error_code(static_cast<int>(lastError), std::system_category());
+                }
+                Close();
+                return false;
+            }
+        }
+        hasPending = false;
+
+        if (IsDotEntry(findData.cFileName))
+        {
+            continue;
+        }
+
+        const int length = WideCharToMultiByte(CP_UTF8, 0, findData.cFileName, -1, nullptr, 0, nullptr, nullptr);
+        if (length <= 1)
+        {
+            continue;
+        }
+
+        name.resize(static_cast<size_t>(length));
+        WideCharToMultiByte(CP_UTF8, 0, findData.cFileName, -1, name.data(), length, nullptr, nullptr);
+
+        entry.name = std::string_view(name.data(), static_cast<size_t>(length - 1));
+        // Directory symlinks and junctions are reparse points.
+        const bool isFolder = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry.isDirectory = isFolder && (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0;
+        entry.isRegularFile = !isFolder && (findData.dwFileAttributes & FILE_ATTRIBUTE_DEVICE) == 0;
+        entry.size = (static_cast<uintmax_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+        entry.modified = ToTicks(findData.ftLastWriteTime);
+        return true;
+    }
+
+    return false;
+}
+
+void CDirReader::Close()
+{
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        FindClose(handle);
+        handle = INVALID_HANDLE_VALUE;
+    }
+    hasPending = false;
+}
+
+int64_t CDirReader::GetModifiedTime(const std::filesystem::path& path, std::error_code& ec)
+{
+    ec.clear();
+    WIN32_FILE_ATTRIBUTE_DATA data{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+    {
+        ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+        return 0;
+    }
+
+    return ToTicks(data.ftLastWriteTime);
+}
+
+std::error_code CDirReader::GetFileInfo(const std::filesystem::path& path, uintmax_t& size, int64_t& modified)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+    {
+        return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    }
+
+    size = (static_cast<uintmax_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    modified = ToTicks(data.ftLastWriteTime);
+    return {};
+}
+
+#else
+
+std::error_code CDirReader::Open(const std::filesystem::path& dir, bool withAttributes)
+{
+    Close();
+    error.clear();
+    attributes = withAttributes;
+
+    fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        error = std::error_code(errno, std::generic_category());
+        return error;
+    }
+
+    buffer.resize(kBufferSize);
+    offset = 0;
+    filled = 0;
+    return error;
+}
+
+bool CDirReader::Next(DirEntryView& entry)
+{
+    while (fd >= 0)
+    {
+        if (offset >= filled)
+        {
+            const long count = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (count <= 0)
+            {
+                if (count < 0)
+                {
+                    error = std::error_code(errno, std::generic_category());
+                }
+                Close();
+                return false;
+            }
+
+            offset = 0;
+            filled = static_cast<size_t>(count);
+        }
+
+        const auto* record = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+        offset += record->d_reclen;
+
+        const char* recordName = record->d_name;
+        if (recordName[0] == '.' && (recordName[1] == '\0' || (recordName[1] == '.' && recordName[2] == '\0')))
+        {
+            continue;
+        }
+
+        entry.name = std::string_view(recordName);
+        entry.isDirectory = record->d_type == DT_DIR;
+        entry.isRegularFile = record->d_type == DT_REG;
+        entry.size = 0;
+        entry.modified = 0;
+
+        // Symlinks and filesystems without d_type need a stat; so do attributes.
+        // A link is only followed to see whether it points at a file.
+        const bool needsStat = record->d_type == DT_UNKNOWN || record->d_type == DT_LNK;
+        if (needsStat || (attributes && entry.isRegularFile))
+        {
+            struct stat info{};
+            if (fstatat(fd, recordName, &info, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                continue;
+            }
+
+            const bool isLink = S_ISLNK(info.st_mode);
+            if (isLink && fstatat(fd, recordName, &info, 0) != 0)
+            {
+                continue;
+            }
+
+            entry.isDirectory = !isLink && S_ISDIR(info.st_mode);
+            entry.isRegularFile = S_ISREG(info.st_mode);
+            entry.size = static_cast<uintmax_t>(info.st_size);
+            entry.modified = ToNanoseconds(info.st_mtim);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void CDirReader::Close()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    offset = 0;
+    filled = 0;
+}
+
+int64_t CDirReader::GetModifiedTime(const std::filesystem::path& path, std::error_code& ec)
+{
+    ec.clear();
+    struct stat info{};
+    if (stat(path.c_str(), &info) != 0)
+    {
+        ec = std::error_code(errno, std::generic_category());
+        return 0;
+    }
+
+    return ToNanoseconds(info.st_mtim);
+}
+
+std::error_code CDirReader::GetFileInfo(const std::filesystem::path& path, uintmax_t& size, int64_t& modified)
+{
+    struct stat info{};
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return std::error_code(errno, std::generic_category());
+    }
+
+    size = static_cast<uintmax_t>(info.st_size);
+    modified = ToNanoseconds(info.st_mtim);
+    return {};
+}
+
+#endif
+
+std::error_code CDirReader::GetError() const
+{
+    return error;
+}
+
+std::filesystem::path CDirReader::Join(const std::filesystem::path& dir, std::string_view name)
+{
+    return dir / std::filesystem::path(std::u8string(name.begin(), name.end()));
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+struct DirEntryView
+{
+    std::string_view name;  // UTF-8, valid until the next call to Next()
+    // Not set for links to folders (symlinks, junctions), so walks never
+    // descend through one and a link cycle cannot make them recurse forever.
+    // A link to a file does count as a regular file.
+    bool isDirectory = false;
+    bool isRegularFile = false;
+    uintmax_t size = 0;     // only filled when the reader was opened with attributes
+    int64_t modified = 0;   // native write time units, compare with GetModifiedTime()
+};
+
+// Bulk directory enumeration on top of the native APIs: FindFirstFileExW with
+// large fetch on Windows, getdents64 on Linux. Entries are handed out as views
+// into reusable buffers and errors are returned instead of thrown.
+class CDirReader
+{
+public:
+    CDirReader() = default;
+    CDirReader(const CDirReader&) = delete;
+    CDirReader& operator=(const CDirReader&) = delete;
+    ~CDirReader();
+
+    std::error_code Open(const std::filesystem::path& dir, bool withAttributes);
+    // Returns false at the end of the listing or on error, see GetError().
+    bool Next(DirEntryView& entry);
+    std::error_code GetError() const;
+    void Close();
+
+    static int64_t GetModifiedTime(const std::filesystem::path& path, std::error_code& ec);
+    static std::error_code GetFileInfo(const std::filesystem::path& path, uintmax_t& size, int64_t& modified);
+    static std::filesystem::path Join(const std::filesystem::path& dir, std::string_view name);
+
+private:
+    std::error_code error;
+    std::string name;
+    bool attributes = false;
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    bool hasPending = false;
+    WIN32_FIND_DATAW findData{};
+#else
+    int fd = -1;
+    std::vector<char> buffer;
+    size_t offset = 0;
+    size_t filled = 0;
+#endif
+};
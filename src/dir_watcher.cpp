@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "dir_watcher.h"
+#include "dir_reader.h"
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t kBufferSize = 64 * 1024;
+
+    bool IsHiddenFolder(std::string_view name)
+    {
+        return !name.empty() && name[0] == '.';
+    }
+}
+
+CDirWatcher::~CDirWatcher()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+struct CDirWatcher::Root
+{
+    std::filesystem::path dir;
+    bool recursive = false;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped{};
+    std::vector<DWORD> buffer;  // DWORD-aligned, as FILE_NOTIFY_INFORMATION requires
+};
+
+std::error_code CDirWatcher::Add(const std::filesystem::path& dir, bool recursive)
+{
+    auto root = std::make_unique<Root>();
+    root->dir = dir;
+    root->recursive = recursive;
+    root->buffer.resize(kBufferSize / sizeof(DWORD));
+    root->handle = CreateFileW(dir.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (root->handle == INVALID_HANDLE_VALUE)
+    {
+        return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    }
+
+    root->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (root->overlapped.hEvent == nullptr)
+    {
+        const std::error_code ec(static_cast<int>(GetLastError()), std::system_category());
+        CloseHandle(root->handle);
+        return ec;
+    }
+
+    const std::error_code ec = Arm(*root);
+    roots.push_back(std::move(root));
+    return ec;
+}
+
+std::error_code CDirWatcher::Arm(Root& root)
+{
+    ResetEvent(root.overlapped.hEvent);
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+    if (!ReadDirectoryChangesW(root.handle, root.buffer.data(), static_cast<DWORD>(root.buffer.size() * sizeof(DWORD)),
+        root.recursive ? TRUE : FALSE, filter, nullptr, &root.overlapped, nullptr))
+    {
+        return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    }
+    return {};
+}
+
+void CDirWatcher::Drain(Root& root, std::vector<DirChange>& changes)
+{
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(root.handle, &root.overlapped, &bytes, FALSE) || bytes == 0)
+    {
+        // The notification buffer overflowed, anything below the root may have changed.
+        changes.push_back({ root.dir, true });
+        return;
+    }
+
+    const char* cursor = reinterpret_cast<const char*>(root.buffer.data());
+    while (true)
+    {
+        const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(cursor);
+        DirChange change;
+        change.path = root.dir / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+
+        // Removed entries cannot be asked whether they were folders; an
+        // extensionless name is assumed to be one.
+        std::error_code ec;
+        if (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME)
+        {
+            change.isDirectory = !change.path.has_extension();
+        }
+        else
+        {
+            change.isDirectory = std::filesystem::is_directory(change.path, ec);
+        }
+
+        // A folder is reported as modified whenever one of its entries
+        // changes; that entry has its own notification.
+        if (!(change.isDirectory && info->Action == FILE_ACTION_MODIFIED))
+        {
+            changes.push_back(std::move(change));
+        }
+
+        if (info->NextEntryOffset == 0)
+        {
+            break;
+        }
+        cursor += info->NextEntryOffset;
+    }
+}
+
+std::error_code CDirWatcher::Wait(int timeoutMs, std::vector<DirChange>& changes)
+{
+    if (roots.empty())
+    {
+        return std::make_error_code(std::errc::bad_file_descriptor);
+    }
+
+    std::vector<HANDLE> events;
+    for (const auto& root : roots)
+    {
+        events.push_back(root->overlapped.hEvent);
+    }
+
+    const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, static_cast<DWORD>(timeoutMs));
+    if (result == WAIT_TIMEOUT)
+    {
+        return {};
+    }
+    if (result >= WAIT_OBJECT_0 + events.size())
+    {
+        return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    }
+
+    // Collect every root that fired, not only the first one.
+    for (auto& root : roots)
+    {
+        if (WaitForSingleObject(root->overlapped.hEvent, 0) != WAIT_OBJECT_0)
+        {
+            continue;
+        }
+
+        Drain(*root, changes);
+        if (const std::error_code ec = Arm(*root))
+        {
+            return ec;
+        }
+    }
+    return {};
+}
+
+void CDirWatcher::Close()
+{
+    for (auto& root : roots)
+    {
+        CancelIo(root->handle);
+        CloseHandle(root->handle);
+        CloseHandle(root->overlapped.hEvent);
+    }
+    roots.clear();
+}
+
+#else
+
+std::error_code CDirWatcher::Add(const std::filesystem::path& dir, bool recursive)
+{
+    if (fd < 0)
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            return std::error_code(errno, std::generic_category());
+        }
+        buffer.resize(kBufferSize);
+    }
+
+    roots.push_back(dir);
+    return AddWatch(dir, recursive);
+}
+
+std::error_code CDirWatcher::AddWatch(const std::filesystem::path& dir, bool recursive)
+{
+    const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+    const int wd = inotify_add_watch(fd, dir.c_str(), mask);
+    if (wd < 0)
+    {
+        return std::error_code(errno, std::generic_category());
+    }
+    watches[wd] = { dir, recursive };
+
+    if (!recursive)
+    {
+        return {};
+    }
+
+    // inotify is not recursive, every folder needs its own watch.
+    std::vector<std::filesystem::path> subdirs;
+    CDirReader reader;
+    reader.Open(dir, false);
+    DirEntryView entry;
+    while (reader.Next(entry))
+    {
+        if (entry.isDirectory && !IsHiddenFolder(entry.name))
+        {
+            subdirs.push_back(CDirReader::Join(dir, entry.name));
+        }
+    }
+    reader.Close();
+
+    for (const auto& subdir : subdirs)
+    {
+        // A folder removed in the meantime is reported by its parent's watch.
+        AddWatch(subdir, true);
+    }
+    return {};
+}
+
+std::error_code CDirWatcher::Wait(int timeoutMs, std::vector<DirChange>& changes)
+{
+    if (fd < 0)
+    {
+        return std::make_error_code(std::errc::bad_file_descriptor);
+    }
+
+    pollfd request{ fd, POLLIN, 0 };
+    const int ready = poll(&request, 1, timeoutMs);
+    if (ready < 0)
+    {
+        return errno == EINTR ? std::error_code() : std::error_code(errno, std::generic_category());
+    }
+    if (ready == 0)
+    {
+        return {};
+    }
+
+    while (true)
+    {
+        const ssize_t length = read(fd, buffer.data(), buffer.size());
+        if (length < 0)
+        {
+            return (errno == EAGAIN || errno == EINTR) ? std::error_code() : std::error_code(errno, std::generic_category());
+        }
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                for (const auto& root : roots)
+                {
+                    changes.push_back({ root, true });
+                }
+                continue;
+            }
+
+            auto it = watches.find(event->wd);
+            if (it == watches.end())
+            {
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED)
+            {
+                watches.erase(it);
+                continue;
+            }
+
+            DirChange change;
+            change.path = event->len > 0 ? CDirReader::Join(it->second.dir, event->name) : it->second.dir;
+            change.isDirectory = (event->mask & (IN_ISDIR | IN_DELETE_SELF)) != 0;
+
+            if (change.isDirectory && it->second.recursive && (event->mask & (IN_CREATE | IN_MOVED_TO))
+                && !IsHiddenFolder(change.path.filename().string()))
+            {
+                AddWatch(change.path, true);
+            }
+            changes.push_back(std::move(change));
+        }
+    }
+}
+
+void CDirWatcher::Close()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    watches.clear();
+    roots.clear();
+}
+
+#endif
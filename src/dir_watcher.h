@@ -0,0 +1,54 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+struct DirChange
+{
+    std::filesystem::path path;
+    bool isDirectory = false;   // also set when the watch overflowed and the whole folder must be assumed changed
+};
+
+// Change notifications for a set of folders: inotify on Linux,
+// ReadDirectoryChangesW on Windows. Recursive watches pick up folders created
+// after Add(). Errors are returned instead of thrown, as in CDirReader.
+class CDirWatcher
+{
+public:
+    CDirWatcher() = default;
+    CDirWatcher(const CDirWatcher&) = delete;
+    CDirWatcher& operator=(const CDirWatcher&) = delete;
+    ~CDirWatcher();
+
+    std::error_code Add(const std::filesystem::path& dir, bool recursive);
+
+    // Waits up to timeoutMs for the next batch of changes and appends it.
+    // Returns without changes on timeout.
+    std::error_code Wait(int timeoutMs, std::vector<DirChange>& changes);
+
+    void Close();
+
+private:
+#ifdef _WIN32
+    struct Root;
+    std::error_code Arm(Root& root);
+    void Drain(Root& root, std::vector<DirChange>& changes);
+
+    std::vector<std::unique_ptr<Root>> roots;
+#else
+    struct Watch
+    {
+        std::filesystem::path dir;
+        bool recursive = false;
+    };
+
+    std::error_code AddWatch(const std::filesystem::path& dir, bool recursive);
+
+    int fd = -1;
+    std::unordered_map<int, Watch> watches;
+    std::vector<std::filesystem::path> roots;
+    std::vector<char> buffer;
+#endif
+};
@@ -5,7 +5,12 @@ BOOL WINAPI DllMain(HINSTANCE hDllHandle, DWORD nReason, LPVOID Reserved)
 {
     if (nReason == DLL_PROCESS_ATTACH)
     {
-        CompInjector loader(hDllHandle);
+        char modulePath[MAX_PATH] = {};
+        GetModuleFileNameA(hDllHandle, modulePath, MAX_PATH);
+
+        // Worker threads cannot start while DllMain holds the loader lock, so by
+        // default all pool tasks run on this thread.
+        CompInjector loader(modulePath, static_cast<size_t>(gConfig.ReadInteger("MAIN", "WorkerThreads", 0)));
     }
     return TRUE;
 }
@@ -0,0 +1,198 @@
+#pragma once
+#include "line_reader.h"
+#include "record_schema.h"
+#include "text_utils.h"
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+// Lazy sequence produced by a coroutine, the C++20 stand-in for
+// std::generator. Values are yielded by reference and only valid until the
+// next increment; iterate it once with a range-for.
+template <typename T>
+class CGenerator
+{
+public:
+    struct promise_type
+    {
+        const T* current = nullptr;
+        std::exception_ptr exception;
+
+        CGenerator get_return_object() { return CGenerator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        // A temporary yielded value lives until the coroutine resumes.
+        std::suspend_always yield_value(const T& value) noexcept
+        {
+            current = std::addressof(value);
+            return {};
+        }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        explicit Iterator(Handle handle) : handle(handle) {}
+
+        const T& operator*() const { return *handle.promise().current; }
+        Iterator& operator++()
+        {
+            Resume(handle);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const { return handle.done(); }
+
+    private:
+        Handle handle;
+    };
+
+    CGenerator(CGenerator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    CGenerator& operator=(CGenerator&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    CGenerator(const CGenerator&) = delete;
+    CGenerator& operator=(const CGenerator&) = delete;
+
+    ~CGenerator()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    Iterator begin()
+    {
+        Resume(handle);
+        return Iterator(handle);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit CGenerator(Handle handle) : handle(handle) {}
+
+    static void Resume(Handle handle)
+    {
+        handle.resume();
+        if (handle.done() && handle.promise().exception)
+        {
+            std::rethrow_exception(handle.promise().exception);
+        }
+    }
+
+    Handle handle;
+};
+
+// Stages the loaders chain into read -> split -> filter -> classify and end
+// in a range-for that acts as the sink. Every stage pulls one line at a time
+// from the one before it, so nothing is buffered between them; a view stays
+// valid as long as the ReadLines() it came from is alive.
+namespace LinePipeline
+{
+    using Lines = CGenerator<std::string_view>;
+
+    // Lines of a buffer, split like CLineReader::Next().
+    inline Lines SplitLines(std::string_view data)
+    {
+        CLineReader reader(data);
+        std::string_view line;
+        while (reader.Next(line))
+        {
+            co_yield line;
+        }
+    }
+
+    // Maps the file for as long as the pipeline runs. A file that cannot be
+    // opened gives no lines. This is the one place file reads happen, so
+    // buffering or read-ahead belongs here.
+    inline Lines ReadLines(std::filesystem::path path)
+    {
+        CMappedFile in;
+        if (in.Open(path))
+        {
+            co_return;
+        }
+
+        for (std::string_view line : SplitLines(in.GetData()))
+        {
+            co_yield line;
+        }
+    }
+
+    // Drops the lines Text::IsCommentOrEmpty() matches.
+    inline Lines StripComments(Lines lines)
+    {
+        for (std::string_view line : lines)
+        {
+            if (!Text::IsCommentOrEmpty(line))
+            {
+                co_yield line;
+            }
+        }
+    }
+
+    // Keeps the lines keep(line) accepts.
+    template <typename Predicate>
+    Lines Filter(Lines lines, Predicate keep)
+    {
+        for (std::string_view line : lines)
+        {
+            if (keep(line))
+            {
+                co_yield line;
+            }
+        }
+    }
+
+    inline Lines TrimLines(Lines lines)
+    {
+        for (std::string_view line : lines)
+        {
+            co_yield Text::Trim(line);
+        }
+    }
+
+    // Tokenizes and classifies every line once; lines without tokens are
+    // dropped.
+    inline CGenerator<CRecordLine> Classify(Lines lines)
+    {
+        for (std::string_view line : lines)
+        {
+            const CRecordLine record(line);
+            if (record.GetShape().count > 0)
+            {
+                co_yield record;
+            }
+        }
+    }
+
+    // The trimmed content lines of a file: what the INI style readers want.
+    inline Lines ContentLines(std::filesystem::path path)
+    {
+        return TrimLines(StripComments(ReadLines(std::move(path))));
+    }
+}
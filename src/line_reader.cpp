@@ -0,0 +1,181 @@
+#include "pch.h"
+#include "line_reader.h"
+#include "text_utils.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+std::error_code CMappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        const std::error_code ec(static_cast<int>(GetLastError()), std::system_category());
+        Close();
+        return ec;
+    }
+
+    open = true;
+    size = static_cast<size_t>(fileSize.QuadPart);
+    if (size == 0)
+    {
+        // Zero-length files cannot be mapped.
+        return {};
+    }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data = mapping != nullptr ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (data == nullptr)
+    {
+        const std::error_code ec(static_cast<int>(GetLastError()), std::system_category());
+        Close();
+        return ec;
+    }
+    return {};
+}
+
+void CMappedFile::Close()
+{
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != nullptr)
+    {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+    }
+
+    data = nullptr;
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+    size = 0;
+    open = false;
+}
+
+#else
+
+std::error_code CMappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::error_code(errno, std::generic_category());
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        const int error = errno != 0 ? errno : EINVAL;
+        ::close(fd);
+        return std::error_code(error, std::generic_category());
+    }
+
+    open = true;
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0)
+    {
+        void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            const std::error_code ec(errno, std::generic_category());
+            ::close(fd);
+            Close();
+            return ec;
+        }
+        madvise(view, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(view);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    return {};
+}
+
+void CMappedFile::Close()
+{
+    if (data != nullptr)
+    {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    data = nullptr;
+    size = 0;
+    open = false;
+}
+
+#endif
+
+bool CMappedFile::IsOpen() const
+{
+    return open;
+}
+
+std::string_view CMappedFile::GetData() const
+{
+    return data != nullptr ? std::string_view(data, size) : std::string_view();
+}
+
+CLineReader::CLineReader(std::string_view data)
+    : data(data)
+{
+    if (data.starts_with("\xEF\xBB\xBF"))
+    {
+        offset = 3;
+    }
+}
+
+bool CLineReader::Next(std::string_view& line)
+{
+    if (offset >= data.size())
+    {
+        return false;
+    }
+
+    const size_t end = Text::FindChar(data, '\n', offset);
+    const size_t lineEnd = end == std::string_view::npos ? data.size() : end;
+    line = data.substr(offset, lineEnd - offset);
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+
+    offset = end == std::string_view::npos ? data.size() : end + 1;
+    return true;
+}
+
+bool CLineReader::NextContent(std::string_view& line)
+{
+    while (Next(line))
+    {
+        if (!Text::IsCommentOrEmpty(line))
+        {
+            return true;
+        }
+    }
+    return false;
+}
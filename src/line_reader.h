@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only view of a whole file, mapped into memory instead of copied.
+// Empty files open fine and give an empty view.
+class CMappedFile
+{
+public:
+    CMappedFile() = default;
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+    ~CMappedFile();
+
+    std::error_code Open(const std::filesystem::path& path);
+    bool IsOpen() const;
+    // Valid until Close().
+    std::string_view GetData() const;
+    void Close();
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool open = false;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// Splits a buffer into lines without copying them. A leading UTF-8 BOM is
+// skipped and the terminator ("\n" or "\r\n") is not part of the line, the
+// same lines a text-mode getline gives on Windows.
+class CLineReader
+{
+public:
+    explicit CLineReader(std::string_view data);
+
+    bool Next(std::string_view& line);
+    // Like Next(), but skips the lines Text::IsCommentOrEmpty() matches.
+    bool NextContent(std::string_view& line);
+
+private:
+    std::string_view data;
+    size_t offset = 0;
+};
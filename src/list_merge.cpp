@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "list_merge.h"
+#include "text_utils.h"
+
+CListMerge::CListMerge(const ListFormat& format, ListMergeMode mode)
+    : format(&format), mode(mode)
+{
+}
+
+void CListMerge::Add(std::string_view text)
+{
+    if (format->separator == ' ')
+    {
+        size_t start = Text::FindFirstNonSpace(text);
+        while (start != Text::npos)
+        {
+            size_t end = start;
+            while (end < text.size() && text[end] != ' ' && text[end] != '\t' && text[end] != '\r' && text[end] != '\n')
+            {
+                ++end;
+            }
+
+            AddElement(text.substr(start, end - start));
+            start = Text::FindFirstNonSpace(text, end);
+        }
+        return;
+    }
+
+    for (const std::string_view element : Text::SplitTrimmed(text, format->separator))
+    {
+        AddElement(element);
+    }
+}
+
+const std::string& CListMerge::GetValue() const
+{
+    return value;
+}
+
+void CListMerge::AddElement(std::string_view element)
+{
+    if (mode == ListMergeMode::Unique)
+    {
+        const bool added = format->ignoreCase ? seen.insert(Text::ToLower(element)).second : seen.emplace(element).second;
+        if (!added)
+        {
+            return;
+        }
+    }
+
+    if (!value.empty())
+    {
+        value += format->joiner;
+    }
+    value += element;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+enum class ListMergeMode
+{
+    // Every element once, where it was first seen.
+    Unique,
+    // Every element of every contribution, duplicates included.
+    KeepDuplicates
+};
+
+// How the elements of a list value are separated. A ' ' separator splits on
+// any run of whitespace.
+struct ListFormat
+{
+    char separator;
+    // Written between elements of the merged value.
+    std::string_view joiner;
+    bool ignoreCase;
+};
+
+// "BALLAS1, BALLAS2": model names, which the game compares without case.
+constexpr ListFormat kCommaList = { ',', ", ", true };
+// "1 2 3"
+constexpr ListFormat kSpaceList = { ' ', " ", false };
+
+// Merges the values several sources give one list key. Each contribution is
+// split once; elements are trimmed, empty ones dropped, and the result is
+// written with the format's joiner.
+class CListMerge
+{
+public:
+    CListMerge(const ListFormat& format, ListMergeMode mode);
+
+    void Add(std::string_view text);
+    const std::string& GetValue() const;
+
+private:
+    void AddElement(std::string_view element);
+
+    const ListFormat* format;
+    ListMergeMode mode;
+    std::string value;
+    std::unordered_set<std::string> seen;
+};
@@ -1,8 +1,10 @@
 #include "pch.h"
 #include "audio.h"
 #include "logger.h"
-#include "tVehicleAudioSetting.h"
-#include <unordered_set> // <<< ADD THIS INCLUDE FOR THE DUPLICATE CHECK
+#include "run_manifest.h"
+#include "line_reader.h"
+#include "text_utils.h"
+#include "record_merge.h"
 
 CFLAAudioLoader FLAAudioLoader;
 
@@ -18,44 +20,17 @@ namespace
 
     bool HasMarker(const std::string& settingsPath)
     {
-        std::ifstream in(settingsPath);
-        if (!in.is_open())
-        {
-            return false;
-        }
-
-        std::string line;
-        while (getline(in, line))
-        {
-            if (line.find(kMarker) != std::string::npos)
-            {
-                return true;
-            }
-        }
-
-        return false;
+        CMappedFile in;
+        return !in.Open(settingsPath) && in.GetData().find(kMarker) != std::string_view::npos;
     }
 }
 
-// <<< MODIFIED FUNCTION TO REBUILD AND REMOVE DUPLICATES >>>
 void CFLAAudioLoader::UpdateAudioFile()
 {
     std::filesystem::path settingsPath = GAME_PATH((char*)"data/gtasa_vehicleAudioSettings.cfg");
     std::filesystem::path settingsPathTemp = settingsPath;
     settingsPathTemp += ".tmp"; // This is just a temporary file
     std::filesystem::path basePath = GetBasePathFromInjector(settingsPath);
-    auto isCommentOrEmpty = [](const std::string &value)
-        {
-            const auto firstNonWhitespace = value.find_first_not_of(" \t\r\n");
-            if (firstNonWhitespace == std::string::npos)
-            {
-                return true;
-            }
-
-            const std::string_view trimmed(value.c_str() + firstNonWhitespace, value.size() - firstNonWhitespace);
-
-            return trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//");
-        };
 
     if (!std::filesystem::exists(basePath))
     {
@@ -65,38 +40,43 @@ void CFLAAudioLoader::UpdateAudioFile()
 
     if (store.empty())
     {
-        std::ifstream in(basePath, std::ios::binary);
+        CMappedFile in;
+        in.Open(basePath);
         std::ofstream out(settingsPathTemp, std::ios::binary | std::ios::trunc);
-        if (!in.is_open() || !out.is_open())
+        if (!in.IsOpen() || !out.is_open())
         {
             return;
         }
 
-        out << in.rdbuf();
-        in.close();
+        const std::string_view base = in.GetData();
+        out.write(base.data(), static_cast<std::streamsize>(base.size()));
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": refreshed " + settingsPath.string());
         return;
     }
 
-    // --- START OF NEW LOGIC ---
-    // 1. Create a "cache" (a hash set) of all lines we intend to add.
-    //    This is very fast for lookups.
-    std::unordered_set<std::string> writtenLines;
-    std::unordered_set<std::string> existingLines;
-    // --- END OF NEW LOGIC ---
+    // Keyed by vehicle name; a mod row overrides the base row in place.
+    CRecordMerge rows(RecordKeyKind::Name, &Record::Key);
+    for (const auto& e : store)
+    {
+        rows.Add(e);
+    }
 
-    std::ifstream in(basePath);
+    CMappedFile in;
+    in.Open(basePath);
     std::ofstream out(settingsPathTemp);
 
-    if (in.is_open() && out.is_open())
+    if (in.IsOpen() && out.is_open())
     {
-        std::string line;
+        CLineReader reader(in.GetData());
+        std::string_view line;
         bool ignoreLines = false;
-        while (getline(in, line))
+        while (reader.Next(line))
         {
             // 2. Check for our old marker
             if (line.find(kMarker) != std::string::npos)
@@ -117,53 +97,43 @@ void CFLAAudioLoader::UpdateAudioFile()
                 continue;
             }
 
-            // --- START OF NEW LOGIC ---
-            // 5. DUPLICATE CHECK: If the line is NOT a marker, and NOT the end,
-            //    check if it's one of the lines we are about to add.
-            //    If it is, skip it (continue) to prevent duplicates.
-            if (isCommentOrEmpty(line))
+            // 5. Comments and blank lines are kept as they are.
+            if (Text::IsCommentOrEmpty(line))
             {
                 out << line << "\n";
                 continue;
             }
 
-            // --- END OF NEW LOGIC ---
-
-            // 6. If none of the above, it's a clean, original line. Write it.
-            out << line << "\n";
-            existingLines.insert(line);
+            // 6. A record row: write it, or the mod row overriding its key.
+            std::string_view row;
+            if (rows.TakeBaseRow(line, row))
+            {
+                out << row << "\n";
+            }
         }
 
         // --- Now, we write the new content ---
 
         out << kMarker << "\n";
 
-        // Write all the lines currently loaded from .comp.injector files
-        for (auto& e : store)
+        for (const std::string_view row : rows.GetAddedRows())
         {
-            if (existingLines.count(e) > 0)
-            {
-                continue;
-            }
-
-            if (writtenLines.insert(e).second)
-            {
-                out << e << "\n";
-            }
+            out << row << "\n";
         }
 
         out << ";the end\n";
 
-        in.close();
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": updated " + settingsPath.string());
     }
     else
     {
-        if (in.is_open()) in.close();
+        if (in.IsOpen()) in.Close();
         if (out.is_open()) out.close();
     }
 }
@@ -178,6 +148,8 @@ void CFLAAudioLoader::Process() {
 
     Logger.Log(std::string(kLogPrefix) + ": processing vehicle audio settings.");
     UpdateAudioFile();
+
+    store.clear();
 }
 
 void CFLAAudioLoader::AddLine(const std::string &line)
@@ -185,30 +157,13 @@ void CFLAAudioLoader::AddLine(const std::string &line)
     store.push_back(line);
 }
 
-void CFLAAudioLoader::Parse(const std::string& line)
+bool CFLAAudioLoader::Parse(const CRecordLine& line)
 {
-    // ... (This function is unchanged)
-    tVehicleAudioSetting setting;
-    int count = sscanf(line.c_str(),
-        "%255s %d %d %d %d %f %f %d %f %d %d %d %d %d %f",
-        setting.Name,
-        &setting.VehAudType,
-        &setting.PlayerBank,
-        &setting.DummyBank,
-        &setting.BassSetting,
-        &setting.BassFactor,
-        &setting.EnginePitch,
-        &setting.HornType,
-        &setting.HornPitch,
-        &setting.DoorType,
-        &setting.EngineUpgrade,
-        &setting.RadioStation,
-        &setting.RadioType,
-        &setting.VehicleAudioTypeForName,
-        &setting.EngineVolumeOffset);
-
-    if (count == 15 && strnlen(setting.Name, sizeof(setting.Name)) > 0)
+    if (!Record::Matches(line))
     {
-        store.push_back(line);
+        return false;
     }
+
+    store.emplace_back(line.GetText());
+    return true;
 }
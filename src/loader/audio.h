@@ -1,4 +1,5 @@
 #pragma once
+#include "record_schema.h"
 #include <vector>
 
 class CFLAAudioLoader
@@ -8,8 +9,18 @@ private:
     void UpdateAudioFile();
 
 public:
+    // Name, VehAudType, PlayerBank, DummyBank, BassSetting, BassFactor,
+    // EnginePitch, HornType, HornPitch, DoorType, EngineUpgrade, RadioStation,
+    // RadioType, VehicleAudioTypeForName, EngineVolumeOffset
+    using Record = CRecordSchema<RecordField::Token,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Int,
+        RecordField::Float, RecordField::Float, RecordField::Int, RecordField::Float,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Int,
+        RecordField::Int, RecordField::Float>;
+
     void AddLine(const std::string &line);
-    void Parse(const std::string &line);
+    // Takes the line when it is a record of this table.
+    bool Parse(const CRecordLine &line);
     void Process();
 };
 
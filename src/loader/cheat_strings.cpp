@@ -1,9 +1,10 @@
 #include "pch.h"
 #include "cheat_strings.h"
 #include "logger.h"
-#include <algorithm>
-#include <cctype>
-#include <unordered_set>
+#include "run_manifest.h"
+#include "line_reader.h"
+#include "text_utils.h"
+#include "record_merge.h"
 
 CFLACheatStringsLoader FLACheatStringsLoader;
 
@@ -11,40 +12,22 @@ namespace {
 const char* kLogPrefix = "CHEAT_STRINGS";
 const char* kMarker = "; comp.injector added cheatStrings";
 
-std::string TrimCopy(const std::string &value)
+std::filesystem::path GetBasePathFromInjector(const std::filesystem::path &settingsPath)
 {
-    const auto start = value.find_first_not_of(" \t\r\n");
-    if (start == std::string::npos)
-    {
-        return "";
-    }
-    const auto end = value.find_last_not_of(" \t\r\n");
-    return value.substr(start, end - start + 1);
+    return GetInjectorBasePath(settingsPath);
 }
 
-std::filesystem::path GetBasePathFromInjector(const std::filesystem::path &settingsPath)
+// "92, CHEATNAME": the id is the token before the comma.
+std::string_view CheatIndex(std::string_view text)
 {
-    return GetInjectorBasePath(settingsPath);
+    size_t offset = 0;
+    return RecordText::NextToken(text.substr(0, text.find(',')), offset);
 }
 
 bool HasMarker(const std::string &settingsPath)
 {
-    std::ifstream in(settingsPath);
-    if (!in.is_open())
-    {
-        return false;
-    }
-
-    std::string line;
-    while (getline(in, line))
-    {
-        if (line.find(kMarker) != std::string::npos)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    CMappedFile in;
+    return !in.Open(settingsPath) && in.GetData().find(kMarker) != std::string_view::npos;
 }
 }
 
@@ -54,18 +37,6 @@ void CFLACheatStringsLoader::UpdateCheatStringsFile()
     std::filesystem::path settingsPathTemp = settingsPath;
     settingsPathTemp += ".tmp";
     std::filesystem::path basePath = GetBasePathFromInjector(settingsPath);
-    auto isCommentOrEmpty = [](const std::string &value)
-        {
-            const auto firstNonWhitespace = value.find_first_not_of(" \t\r\n");
-            if (firstNonWhitespace == std::string::npos)
-            {
-                return true;
-            }
-
-            const std::string_view trimmed(value.c_str() + firstNonWhitespace, value.size() - firstNonWhitespace);
-
-            return trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//");
-        };
 
     if (!std::filesystem::exists(basePath))
     {
@@ -75,34 +46,43 @@ void CFLACheatStringsLoader::UpdateCheatStringsFile()
 
     if (store.empty())
     {
-        std::ifstream in(basePath, std::ios::binary);
+        CMappedFile in;
+        in.Open(basePath);
         std::ofstream out(settingsPathTemp, std::ios::binary | std::ios::trunc);
-        if (!in.is_open() || !out.is_open())
+        if (!in.IsOpen() || !out.is_open())
         {
             return;
         }
 
-        out << in.rdbuf();
-        in.close();
+        const std::string_view base = in.GetData();
+        out.write(base.data(), static_cast<std::streamsize>(base.size()));
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": refreshed " + settingsPath.string());
         return;
     }
 
-    std::unordered_set<std::string> writtenLines;
-    std::unordered_set<std::string> existingLines;
+    // Keyed by cheat id, last mod wins.
+    CRecordMerge rows(RecordKeyKind::Int, &CheatIndex);
+    for (const auto& e : store)
+    {
+        rows.Add(e);
+    }
 
-    std::ifstream in(basePath);
+    CMappedFile in;
+    in.Open(basePath);
     std::ofstream out(settingsPathTemp);
 
-    if (in.is_open() && out.is_open())
+    if (in.IsOpen() && out.is_open())
     {
-        std::string line;
+        CLineReader reader(in.GetData());
+        std::string_view line;
         bool ignoreLines = false;
-        while (getline(in, line))
+        while (reader.Next(line))
         {
             if (line.find(kMarker) != std::string::npos)
             {
@@ -115,41 +95,37 @@ void CFLACheatStringsLoader::UpdateCheatStringsFile()
                 continue;
             }
 
-            if (isCommentOrEmpty(line))
+            if (Text::IsCommentOrEmpty(line))
             {
                 out << line << "\n";
                 continue;
             }
 
-            out << line << "\n";
-            existingLines.insert(line);
+            std::string_view row;
+            if (rows.TakeBaseRow(line, row))
+            {
+                out << row << "\n";
+            }
         }
 
         out << kMarker << "\n";
 
-        for (const auto &e : store)
+        for (const std::string_view row : rows.GetAddedRows())
         {
-            if (existingLines.count(e) > 0)
-            {
-                continue;
-            }
-
-            if (writtenLines.insert(e).second)
-            {
-                out << e << "\n";
-            }
+            out << row << "\n";
         }
 
-        in.close();
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": updated " + settingsPath.string());
     }
     else
     {
-        if (in.is_open()) in.close();
+        if (in.IsOpen()) in.Close();
         if (out.is_open()) out.close();
     }
 }
@@ -164,6 +140,8 @@ void CFLACheatStringsLoader::Process()
 
     Logger.Log(std::string(kLogPrefix) + ": processing cheat strings.");
     UpdateCheatStringsFile();
+
+    store.clear();
 }
 
 void CFLACheatStringsLoader::AddLine(const std::string &line)
@@ -171,46 +149,30 @@ void CFLACheatStringsLoader::AddLine(const std::string &line)
     store.push_back(line);
 }
 
-void CFLACheatStringsLoader::Parse(const std::string &line)
+bool CFLACheatStringsLoader::Parse(const CRecordLine &line)
 {
-    const auto commaPos = line.find(',');
-    if (commaPos == std::string::npos)
+    // Cheat lines are comma separated, so only the raw text is of use here.
+    const std::string_view text = line.GetText();
+    const auto commaPos = text.find(',');
+    if (commaPos == std::string_view::npos)
     {
-        return;
-    }
-
-    const std::string idPart = TrimCopy(line.substr(0, commaPos));
-    if (idPart.empty())
-    {
-        return;
+        return false;
     }
 
     int index = 0;
-    try
+    if (!RecordText::ParseInt(CheatIndex(text), index) || index <= 91)
     {
-        index = std::stoi(idPart);
-    }
-    catch (const std::exception &)
-    {
-        return;
-    }
-
-    if (index <= 91)
-    {
-        return;
+        return false;
     }
 
-    std::string remainder = line.substr(commaPos + 1);
-    const auto commentPos = remainder.find('#');
-    if (commentPos != std::string::npos)
-    {
-        remainder = remainder.substr(0, commentPos);
-    }
+    std::string_view remainder = text.substr(commaPos + 1);
+    remainder = remainder.substr(0, remainder.find('#'));
 
-    if (TrimCopy(remainder).empty())
+    if (Text::Trim(remainder).empty())
     {
-        return;
+        return false;
     }
 
-    store.push_back(line);
+    store.emplace_back(text);
+    return true;
 }
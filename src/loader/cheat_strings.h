@@ -1,4 +1,5 @@
 #pragma once
+#include "record_schema.h"
 #include <vector>
 
 class CFLACheatStringsLoader
@@ -9,7 +10,8 @@ private:
 
 public:
     void AddLine(const std::string &line);
-    void Parse(const std::string &line);
+    // Takes the line when it is a cheat string record.
+    bool Parse(const CRecordLine &line);
     void Process();
 };
 
@@ -1,8 +1,18 @@
 #include "pch.h"
 #include "inj_config.h"
 #include "logger.h"
+#include "run_manifest.h"
+#include "line_pipeline.h"
+#include "text_utils.h"
+#include "modloader_index.h"
+#include "dir_reader.h"
+#include "task_pool.h"
+#include "list_merge.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
-#include <optional>
+#include <iterator>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -11,267 +21,723 @@ CInjConfigLoader InjConfigLoader;
 namespace
 {
     const char* kLogPrefix = "INJ";
-    bool IsCommentOrEmpty(const std::string& line)
+    const char* kMissingCacheFileName = "inj_missing.cache";
+
+    std::filesystem::path GetBasePathFromInjector(const std::filesystem::path& iniPath)
     {
-        const auto firstNonWhitespace = line.find_first_not_of(" \t\r\n");
-        if (firstNonWhitespace == std::string::npos)
+        return GetInjectorBasePath(iniPath);
+    }
+
+    // modloader is already covered by the shared index, so disk walks skip it.
+    bool IsIndexedModloaderRoot(const std::filesystem::path& dir)
+    {
+        if (!Text::EqualsIgnoreCase(dir.filename().string(), "modloader"))
         {
-            return true;
+            return false;
         }
 
-        const std::string_view trimmed(line.c_str() + firstNonWhitespace, line.size() - firstNonWhitespace);
-        return trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//");
+        std::error_code ec;
+        return std::filesystem::equivalent(dir, ModloaderIndex.GetRoot(), ec);
     }
 
-    std::string Trim(const std::string& value)
+    // The reference baselines and the cache are the plugin's own files and
+    // never targets; the cache changes on every run besides.
+    bool IsPluginDataFolder(const std::filesystem::path& dir)
     {
-        const auto first = value.find_first_not_of(" \t\r\n");
-        if (first == std::string::npos)
+        const std::string name = dir.filename().string();
+        if (!Text::EqualsIgnoreCase(name, "reference") && !Text::EqualsIgnoreCase(name, "cache"))
         {
-            return "";
+            return false;
         }
 
-        const auto last = value.find_last_not_of(" \t\r\n");
-        return value.substr(first, last - first + 1);
+        std::error_code ec;
+        return std::filesystem::equivalent(dir, GetInjectorBasePath(dir).parent_path(), ec)
+            || std::filesystem::equivalent(dir, Logger.GetCacheDirectory(), ec);
     }
 
-    std::string TrimLeft(const std::string& value)
+    // Restore *.ini from /injector originals for every indexed modloader file (best-effort).
+    // This is the "nothing to update => reset to baseline" behavior.
+    void RestoreIniFilesFromInjector()
     {
-        const auto first = value.find_first_not_of(" \t\r\n");
-        if (first == std::string::npos)
+        for (const ModloaderFile* file : ModloaderIndex.FindByExtension(".ini"))
         {
-            return "";
-        }
+            const std::filesystem::path& iniPath = file->path;
+            const std::filesystem::path injectorPath = GetBasePathFromInjector(iniPath);
+            if (!std::filesystem::exists(injectorPath))
+            {
+                continue;
+            }
 
-        return value.substr(first);
+            try
+            {
+                std::filesystem::copy_file(injectorPath, iniPath, std::filesystem::copy_options::overwrite_existing);
+                RunManifest.RecordOutput(iniPath);
+            }
+            catch (const std::exception&)
+            {
+                // Intentionally ignore; restore is best-effort.
+            }
+        }
     }
 
-    std::string ToLowerStr(std::string s)
+    bool TryParseModifierLine(std::string_view line, InjModifier& modifier, bool& opensBlock)
     {
-        for (char& c : s)
+        std::string_view trimmed = Text::Trim(line);
+        opensBlock = false;
+
+        if (trimmed.empty())
+        {
+            return false;
+        }
+
+        if (trimmed.back() == '{')
+        {
+            trimmed = Text::Trim(trimmed.substr(0, trimmed.size() - 1));
+            opensBlock = true;
+        }
+
+        if (Text::EqualsIgnoreCase(trimmed, "Replace"))
         {
-            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            modifier = InjModifier::Replace;
+            return true;
         }
-        return s;
+
+        if (Text::EqualsIgnoreCase(trimmed, "Merge"))
+        {
+            modifier = InjModifier::Merge;
+            return true;
+        }
+
+        return false;
     }
 
-    bool IsHiddenFolder(const std::filesystem::path& p)
+    bool IsBlank(char ch)
     {
-        const std::string name = p.filename().string();
-        return !name.empty() && name[0] == '.';
+        return ch == ' ' || ch == '\t';
     }
 
-    std::filesystem::path GetBasePathFromInjector(const std::filesystem::path& iniPath)
+    // Keeps the key, the '=' and the blanks after it, and puts value behind them.
+    void SetLineValue(std::string& line, std::string_view value)
     {
-        return GetInjectorBasePath(iniPath);
+        const size_t equals = line.find('=');
+        const size_t valueStart = line.find_first_not_of(" \t", equals + 1);
+        line.resize(valueStart == std::string::npos ? equals + 1 : valueStart);
+        line += value;
     }
 
-    // Restore *.ini from /injector originals under a root folder (best-effort).
-    // This is the "nothing to update => reset to baseline" behavior.
-    void RestoreIniFilesFromInjector(const std::filesystem::path& root)
+    // A target ini as a piece table over its mapped base file. The base
+    // bytes are never copied: a value rewrite is a splice replacing the end
+    // of one line, keys added to a section are queued where its text ends
+    // and new sections go after the end of the file. Write() streams the
+    // untouched spans, splices and added lines in file order, so everything
+    // outside the edited values keeps its original bytes, line endings
+    // included. The text passed in has to outlive the patch; names point
+    // into it or into the loader's name table.
+    class CIniPatch
     {
-        if (root.empty() || !std::filesystem::exists(root))
+    public:
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        explicit CIniPatch(std::string_view text)
+            : base(text)
         {
-            return;
-        }
+            const size_t newline = base.find('\n');
+            if (newline != std::string_view::npos)
+            {
+                eol = newline > 0 && base[newline - 1] == '\r' ? "\r\n" : "\n";
+            }
 
-        std::filesystem::directory_options options = std::filesystem::directory_options::skip_permission_denied;
+            // Sections are indexed once, the first of every name with the
+            // first line of every key in it.
+            spans.push_back({ 0, {} });
+            keys.emplace_back();
 
-        for (auto it = std::filesystem::recursive_directory_iterator(root, options);
-            it != std::filesystem::recursive_directory_iterator();
-            ++it)
-        {
-            if (it->is_directory())
+            CLineReader reader(text);
+            std::string_view line;
+            bool indexed = false;
+            while (reader.Next(line))
             {
-                if (IsHiddenFolder(it->path()))
+                const size_t lineStart = static_cast<size_t>(line.data() - base.data());
+                hasLines = true;
+                lastLineEmpty = line.empty();
+
+                const std::string_view trimmed = Text::Trim(line);
+                if (trimmed.size() >= 3 && trimmed.front() == '[' && trimmed.back() == ']')
                 {
-                    it.disable_recursion_pending();
+                    const std::string_view name = Text::Trim(trimmed.substr(1, trimmed.size() - 2));
+                    if (!name.empty())
+                    {
+                        spans.back().end = lineStart;
+                        spans.push_back({ 0, {} });
+                        keys.emplace_back();
+                        indexed = sections.emplace(name, spans.size() - 1).second;
+                    }
+                }
+                else if (indexed && !Text::IsCommentOrEmpty(line))
+                {
+                    const size_t equals = Text::FindChar(line, '=');
+                    if (equals != Text::npos)
+                    {
+                        keys.back().emplace(Text::Trim(line.substr(0, equals)), KeyLine{ npos, lineStart + equals, lineStart + line.size() });
+                    }
                 }
-                continue;
             }
+            spans.back().end = base.size();
+        }
+
+        size_t FindSection(std::string_view name) const
+        {
+            auto it = sections.find(name);
+            return it == sections.end() ? npos : it->second;
+        }
 
-            if (!it->is_regular_file())
+        // Returns false when the section has no such key.
+        bool SetValue(size_t section, std::string_view key, std::string_view value)
+        {
+            auto it = keys[section].find(key);
+            if (it == keys[section].end())
             {
-                continue;
+                return false;
             }
 
-            const std::filesystem::path iniPath = it->path();
-            if (ToLowerStr(iniPath.extension().string()) != ".ini")
+            const KeyLine& line = it->second;
+            if (line.added != npos)
             {
-                continue;
+                SetLineValue(spans[section].added[line.added], value);
+                return true;
             }
 
-            const std::filesystem::path injectorPath = GetBasePathFromInjector(iniPath);
-            if (!std::filesystem::exists(injectorPath))
+            // Same result as SetLineValue() on the current text of the line.
+            auto [splice, inserted] = splices.try_emplace(line.equals);
+            Splice& edit = splice->second;
+            if (inserted)
             {
-                continue;
+                edit.cut = line.equals + 1;
+                edit.lineEnd = line.lineEnd;
+                while (edit.cut < line.lineEnd && IsBlank(base[edit.cut]))
+                {
+                    ++edit.cut;
+                }
+                if (edit.cut == line.lineEnd)
+                {
+                    edit.cut = line.equals + 1;
+                }
+                edit.tail = value;
+                return true;
             }
 
-            try
+            size_t blanks = 0;
+            while (blanks < edit.tail.size() && IsBlank(edit.tail[blanks]))
             {
-                std::filesystem::copy_file(injectorPath, iniPath, std::filesystem::copy_options::overwrite_existing);
+                ++blanks;
             }
-            catch (const std::exception&)
+            if (blanks == edit.tail.size())
             {
-                // Intentionally ignore; restore is best-effort.
+                edit.cut = line.equals + 1;
+                blanks = 0;
             }
+            edit.tail.resize(blanks);
+            edit.tail += value;
+            return true;
         }
-    }
 
-    bool EqualsIgnoreCase(const std::string& left, const std::string& right)
-    {
-        if (left.size() != right.size())
+        void AddKey(size_t section, std::string_view key, std::string_view value)
         {
-            return false;
+            keys[section].emplace(key, KeyLine{ spans[section].added.size(), 0, 0 });
+            spans[section].added.push_back(std::string(key) + "=" + std::string(value));
         }
 
-        for (size_t i = 0; i < left.size(); ++i)
+        // Appends the section at the end of the file, after a blank line.
+        void AddSection(std::string_view name, std::string_view key, std::string_view value)
         {
-            if (std::tolower(static_cast<unsigned char>(left[i])) != std::tolower(static_cast<unsigned char>(right[i])))
+            const std::vector<std::string>& lastAdded = spans.back().added;
+            const bool lastEmpty = lastAdded.empty() ? !hasLines || lastLineEmpty : lastAdded.back().empty();
+            if (!lastEmpty)
             {
-                return false;
+                spans.back().added.emplace_back();
             }
+
+            spans.push_back({ base.size(), {} });
+            keys.emplace_back();
+            sections.emplace(name, spans.size() - 1);
+            spans.back().added.push_back("[" + std::string(name) + "]");
+            AddKey(spans.size() - 1, key, value);
         }
 
-        return true;
-    }
+        bool Write(std::ostream& out) const
+        {
+            // Lines added at the end of the file follow its last line break,
+            // or start with one when the file does not end in one.
+            const bool endsWithBreak = !hasLines || base.back() == '\n';
 
-    bool TryParseModifierLine(const std::string& line, InjModifier& modifier, bool& opensBlock)
-    {
-        std::string trimmed = Trim(line);
-        opensBlock = false;
+            size_t offset = 0;
+            auto splice = splices.begin();
+            for (const auto& span : spans)
+            {
+                for (; splice != splices.end() && splice->first < span.end; ++splice)
+                {
+                    out.write(base.data() + offset, static_cast<std::streamsize>(splice->second.cut - offset));
+                    out << splice->second.tail;
+                    offset = splice->second.lineEnd;
+                }
+                out.write(base.data() + offset, static_cast<std::streamsize>(span.end - offset));
+                offset = span.end;
 
-        if (trimmed.empty())
+                const bool atEnd = span.end == base.size();
+                for (const auto& line : span.added)
+                {
+                    if (atEnd && !endsWithBreak)
+                    {
+                        out << eol << line;
+                    }
+                    else
+                    {
+                        out << line << eol;
+                    }
+                }
+            }
+            return static_cast<bool>(out);
+        }
+
+    private:
+        // The header line (none for the part before the first one) and the
+        // base text up to the next header end at end; added lines go there.
+        struct Span
+        {
+            size_t end;
+            std::vector<std::string> added;
+        };
+
+        // A key line of the base (equals and lineEnd are offsets into it) or
+        // one of the lines added to the section.
+        struct KeyLine
+        {
+            size_t added;
+            size_t equals;
+            size_t lineEnd;
+        };
+
+        // The base bytes [cut, lineEnd) replaced by tail.
+        struct Splice
+        {
+            size_t cut = 0;
+            size_t lineEnd = 0;
+            std::string tail;
+        };
+
+        std::string_view base;
+#ifdef _WIN32
+        const char* eol = "\r\n";
+#else
+        const char* eol = "\n";
+#endif
+        bool hasLines = false;
+        bool lastLineEmpty = false;
+        std::vector<Span> spans;
+        std::unordered_map<std::string_view, size_t> sections;
+        std::vector<std::unordered_map<std::string_view, KeyLine>> keys;
+        // By the base offset of the line's '=', which is in file order.
+        std::map<size_t, Splice> splices;
+    };
+
+    bool TryParseSection(std::string_view line, std::string& section)
+    {
+        const std::string_view trimmed = Text::Trim(line);
+        if (trimmed.size() < 3 || trimmed.front() != '[' || trimmed.back() != ']')
         {
             return false;
         }
 
-        if (trimmed.back() == '{')
+        section = Text::Trim(trimmed.substr(1, trimmed.size() - 2));
+        return !section.empty();
+    }
+
+    // Remembers the last name it interned; .inj entries come in runs under
+    // the same target file and section.
+    class CNameCache
+    {
+    public:
+        explicit CNameCache(CStringInterner& names) : names(names) {}
+
+        CStringInterner::Id Get(std::string_view text)
         {
-            trimmed = Trim(trimmed.substr(0, trimmed.size() - 1));
-            opensBlock = true;
+            if (!valid || text != last)
+            {
+                id = names.Intern(text);
+                last = names.GetString(id);
+                valid = true;
+            }
+            return id;
         }
 
-        if (EqualsIgnoreCase(trimmed, "Replace"))
+    private:
+        CStringInterner& names;
+        CStringInterner::Id id = 0;
+        std::string_view last;
+        bool valid = false;
+    };
+
+    std::filesystem::path GetGameRoot()
+    {
+        // GAME_PATH("") ends with a separator, the parent is the folder itself.
+        return std::filesystem::path(GAME_PATH((char*)"")).parent_path();
+    }
+
+    struct SearchSettings
+    {
+        std::vector<std::filesystem::path> roots;
+        int maxDepth = -1;
+        int missingCacheHours = 24;
+    };
+
+    // [INJ] SearchRoots is a ';'-separated list of folders relative to the game
+    // root (default: the game root itself). SearchDepth limits how deep the
+    // search descends, -1 means unlimited.
+    SearchSettings ReadSearchSettings(const std::filesystem::path& gameRoot)
+    {
+        SearchSettings settings;
+        settings.maxDepth = gConfig.ReadInteger("INJ", "SearchDepth", -1);
+        settings.missingCacheHours = gConfig.ReadInteger("INJ", "MissingCacheHours", 24);
+
+        const std::string roots = gConfig.ReadString("INJ", "SearchRoots", "");
+        size_t start = 0;
+        while (start <= roots.size())
         {
-            modifier = InjModifier::Replace;
-            return true;
+            size_t end = roots.find(';', start);
+            if (end == std::string::npos)
+            {
+                end = roots.size();
+            }
+
+            const std::string root(Text::Trim(std::string_view(roots).substr(start, end - start)));
+            if (!root.empty())
+            {
+                const std::filesystem::path rootPath(root);
+                settings.roots.push_back(rootPath.is_absolute() ? rootPath : gameRoot / rootPath);
+            }
+            start = end + 1;
         }
 
-        if (EqualsIgnoreCase(trimmed, "Merge"))
+        if (settings.roots.empty() && !gameRoot.empty())
         {
-            modifier = InjModifier::Merge;
-            return true;
+            settings.roots.push_back(gameRoot);
         }
 
-        return false;
+        return settings;
     }
 
-    void AppendMergeValue(std::string& target, const std::string& candidate)
+    std::string ToUtf8(const std::filesystem::path& path)
     {
-        if (candidate.empty())
+        const std::u8string value = path.u8string();
+        return std::string(value.begin(), value.end());
+    }
+
+    std::filesystem::path FromUtf8(const std::string& value)
+    {
+        return std::filesystem::path(std::u8string(value.begin(), value.end()));
+    }
+
+    // Missing targets are only trusted while the search configuration is the
+    // same and no folder the search read has changed since.
+    std::string MakeSearchSignature(const SearchSettings& settings)
+    {
+        std::string signature = "depth=" + std::to_string(settings.maxDepth);
+        for (const auto& root : settings.roots)
         {
-            return;
+            signature += "|" + ToUtf8(root);
         }
+        return signature;
+    }
+
+    // Paths written by different code agree once normalized.
+    std::string ToFolderKey(const std::filesystem::path& path)
+    {
+        return ToUtf8(path.lexically_normal());
+    }
 
-        if (!target.empty())
+    bool ContainsAnyName(const std::filesystem::path& dir, const std::unordered_set<std::string>& names)
+    {
+        CDirReader reader;
+        reader.Open(dir, false);
+        DirEntryView entry;
+        while (reader.Next(entry))
         {
-            if (!std::isspace(static_cast<unsigned char>(target.back())))
+            if (names.count(Text::ToLower(entry.name)) > 0)
             {
-                target += " ";
+                return true;
             }
         }
+        return false;
+    }
+
+    // Every folder a search read, by UTF-8 path, with its write time from
+    // just before it was read. A file added anywhere below a root changes
+    // the time of the folder it lands in.
+    using SearchedFolders = std::unordered_map<std::string, int64_t>;
 
-        target += candidate;
+    int64_t NowInSeconds()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
 
-    bool TryParseSection(const std::string& line, std::string& section)
+    std::unordered_map<std::string, int64_t> LoadMissingTargets(
+        const std::filesystem::path& cachePath,
+        const std::string& signature,
+        int maxAgeHours,
+        SearchedFolders& searched)
     {
-        std::string trimmed = Trim(line);
-        if (trimmed.size() < 3 || trimmed.front() != '[' || trimmed.back() != ']')
+        std::unordered_map<std::string, int64_t> missing;
+        std::ifstream in(cachePath, std::ios::binary);
+        if (!in.is_open())
         {
-            return false;
+            return missing;
         }
 
-        section = Trim(trimmed.substr(1, trimmed.size() - 2));
-        return !section.empty();
-    }
+        std::string line;
+        if (!getline(in, line) || line != signature)
+        {
+            return missing;
+        }
 
-    std::filesystem::path GetGameRoot()
-    {
-        char buffer[MAX_PATH] = {};
-        if (GetModuleFileNameA(nullptr, buffer, MAX_PATH) == 0)
+        const int64_t oldest = NowInSeconds() - static_cast<int64_t>(maxAgeHours) * 3600;
+        while (getline(in, line))
         {
-            return {};
+            // D <write time> <searched folder>
+            if (line.starts_with("D "))
+            {
+                const auto space = line.find(' ', 2);
+                if (space == std::string::npos)
+                {
+                    continue;
+                }
+
+                const std::string path = line.substr(space + 1);
+                int64_t recorded = 0;
+                try
+                {
+                    recorded = std::stoll(line.substr(2, space - 2));
+                }
+                catch (const std::exception&)
+                {
+                    searched.clear();
+                    return {};
+                }
+
+                // A folder that did not exist was recorded as 0.
+                std::error_code ec;
+                const int64_t modified = CDirReader::GetModifiedTime(FromUtf8(path), ec);
+                if ((ec ? 0 : modified) != recorded)
+                {
+                    Logger.Log(std::string(kLogPrefix) + ": " + FromUtf8(path).string() + " changed, searching missing targets again.");
+                    searched.clear();
+                    return {};
+                }
+
+                searched.emplace(path, recorded);
+                continue;
+            }
+
+            // <seconds since epoch> <lowercase file name>
+            const auto space = line.find(' ');
+            if (space == std::string::npos)
+            {
+                continue;
+            }
+
+            int64_t seen = 0;
+            try
+            {
+                seen = std::stoll(line.substr(0, space));
+            }
+            catch (const std::exception&)
+            {
+                continue;
+            }
+
+            if (seen >= oldest)
+            {
+                missing[line.substr(space + 1)] = seen;
+            }
         }
 
-        return std::filesystem::path(buffer).parent_path();
+        return missing;
     }
 
-    std::optional<std::filesystem::path> FindFileByName(
-        const std::filesystem::path& root,
-        const std::string& filename)
+    void SaveMissingTargets(
+        const std::filesystem::path& cachePath,
+        const std::string& signature,
+        const SearchedFolders& searched,
+        const std::unordered_map<std::string, int64_t>& missing)
     {
-        if (root.empty() || !std::filesystem::exists(root))
+        std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
         {
-            return std::nullopt;
+            return;
         }
 
-        std::filesystem::directory_options options = std::filesystem::directory_options::skip_permission_denied;
-        for (auto it = std::filesystem::recursive_directory_iterator(root, options);
-            it != std::filesystem::recursive_directory_iterator();
-            ++it)
+        out << signature << "\n";
+        for (const auto& folder : searched)
+        {
+            out << "D " << folder.second << " " << folder.first << "\n";
+        }
+        for (const auto& name : missing)
+        {
+            out << name.second << " " << name.first << "\n";
+        }
+    }
+
+    // Files of a folder are checked before its subfolders, so shallower matches win.
+    void SearchFolder(
+        const std::filesystem::path& dir,
+        int depth,
+        const SearchSettings& settings,
+        const std::unordered_set<std::string>& wanted,
+        std::unordered_map<std::string, std::filesystem::path>& found,
+        SearchedFolders& searched)
+    {
+        std::error_code ec;
+        const int64_t modified = CDirReader::GetModifiedTime(dir, ec);
+        searched[ToUtf8(dir)] = ec ? 0 : modified;
+
+        std::vector<std::string> subdirs;
+        CDirReader reader;
+        reader.Open(dir, false);
+
+        DirEntryView entry;
+        while (reader.Next(entry))
         {
-            if (it->is_directory())
+            if (entry.isDirectory)
             {
-                if (IsHiddenFolder(it->path()))
+                if (!entry.name.starts_with('.'))
                 {
-                    it.disable_recursion_pending();
+                    subdirs.emplace_back(entry.name);
                 }
                 continue;
             }
 
-            if (!it->is_regular_file())
+            if (!entry.isRegularFile)
             {
                 continue;
             }
 
-            if (it->path().filename().string() == filename)
+            const std::string name = Text::ToLower(entry.name);
+            if (wanted.count(name) > 0 && found.count(name) == 0)
             {
-                return it->path();
+                found.emplace(name, CDirReader::Join(dir, entry.name));
             }
         }
+        reader.Close();
 
-        return std::nullopt;
+        if (settings.maxDepth >= 0 && depth >= settings.maxDepth)
+        {
+            return;
+        }
+
+        std::sort(subdirs.begin(), subdirs.end());
+        for (const auto& subdir : subdirs)
+        {
+            if (found.size() == wanted.size())
+            {
+                return;
+            }
+
+            const std::filesystem::path subdirPath = CDirReader::Join(dir, subdir);
+            if (IsIndexedModloaderRoot(subdirPath) || IsPluginDataFolder(subdirPath))
+            {
+                continue;
+            }
+
+            SearchFolder(subdirPath, depth + 1, settings, wanted, found, searched);
+        }
+    }
+
+    // One walk over the search roots for every wanted name at once. The first
+    // match in root order wins; the walk stops as soon as every name is found.
+    std::unordered_map<std::string, std::filesystem::path> FindFilesByName(
+        const SearchSettings& settings,
+        const std::unordered_set<std::string>& wanted,
+        SearchedFolders& searched)
+    {
+        std::unordered_map<std::string, std::filesystem::path> found;
+        for (const auto& root : settings.roots)
+        {
+            if (found.size() == wanted.size())
+            {
+                break;
+            }
+
+            SearchFolder(root, 0, settings, wanted, found, searched);
+        }
+
+        return found;
     }
 }
 
 void CInjConfigLoader::Process(const std::filesystem::path& pluginDir)
 {
     entries.clear();
+    sources.clear();
+    valueArenas.clear();
+    pluginInjFiles.clear();
+    inputFolders.clear();
 
-    std::vector<std::filesystem::path> injFiles;
-    const std::filesystem::path modloaderRoot = GAME_PATH((char*)"modloader");
+    for (const ModloaderFile* file : ModloaderIndex.FindByExtension(".inj"))
+    {
+        sources.push_back(file->path);
+    }
 
-    CollectInjFiles(modloaderRoot, injFiles);
     if (!pluginDir.empty())
     {
-        CollectInjFiles(pluginDir, injFiles);
+        CollectInjFiles(pluginDir, pluginInjFiles);
+        sources.insert(sources.end(), pluginInjFiles.begin(), pluginInjFiles.end());
+
+        inputFolders.push_back(pluginDir);
+        for (const auto& file : pluginInjFiles)
+        {
+            inputFolders.push_back(file.parent_path());
+        }
     }
 
-    Logger.Log(std::string(kLogPrefix) + ": found " + std::to_string(injFiles.size()) + " .inj files.");
+    Logger.Log(std::string(kLogPrefix) + ": found " + std::to_string(sources.size()) + " .inj files.");
+
+    // [INJ] KeepDuplicates: ','-separated keys whose merged lists keep every
+    // element.
+    keepDuplicateKeys.clear();
+    const std::string keepDuplicates = gConfig.ReadString("INJ", "KeepDuplicates", "");
+    for (const std::string_view key : Text::SplitTrimmed(keepDuplicates, ','))
+    {
+        keepDuplicateKeys.insert(names.Intern(key));
+    }
 
     // If there are no .inj files at all, restore every *.ini from /injector in /modloader.
-    if (injFiles.empty())
+    if (sources.empty())
     {
         Logger.Log(std::string(kLogPrefix) + ": no .inj files found, restoring ini files from /injector.");
-        RestoreIniFilesFromInjector(modloaderRoot);
+        RestoreIniFilesFromInjector();
         return;
     }
 
-    for (const auto& file : injFiles)
+    // Every file is parsed into its own buffer, possibly on another thread,
+    // and the buffers are joined in discovery order so later files still
+    // replace or merge over earlier ones exactly as before.
+    std::vector<std::vector<InjEntry>> parsed(sources.size());
+    valueArenas.resize(sources.size());
+    TaskPool.ParallelFor(sources.size(), [this, &parsed](size_t i)
+        {
+            ParseFile(static_cast<uint32_t>(i), parsed[i], valueArenas[i]);
+        });
+
+    size_t total = 0;
+    for (const auto& fileEntries : parsed)
+    {
+        total += fileEntries.size();
+    }
+
+    entries.reserve(total);
+    for (auto& fileEntries : parsed)
     {
-        ParseFile(file);
+        entries.insert(entries.end(), std::make_move_iterator(fileEntries.begin()), std::make_move_iterator(fileEntries.end()));
     }
 
     Logger.Log(std::string(kLogPrefix) + ": parsed " + std::to_string(entries.size()) + " entries.");
@@ -280,25 +746,36 @@ void CInjConfigLoader::Process(const std::filesystem::path& pluginDir)
     if (entries.empty())
     {
         Logger.Log(std::string(kLogPrefix) + ": no entries parsed, restoring ini files from /injector.");
-        RestoreIniFilesFromInjector(modloaderRoot);
+        RestoreIniFilesFromInjector();
         return;
     }
 
-    std::unordered_map<std::string, std::filesystem::path> cache;
-    std::unordered_set<std::string> missing;
     std::unordered_map<std::filesystem::path, std::vector<InjEntry>> grouped;
 
-    const std::filesystem::path gameRoot = GetGameRoot();
+    const std::unordered_map<std::string, std::filesystem::path> resolved = ResolveIniFiles(GetGameRoot(), inputFolders);
+    std::sort(inputFolders.begin(), inputFolders.end());
+    inputFolders.erase(std::unique(inputFolders.begin(), inputFolders.end()), inputFolders.end());
 
+    // Entries of one .inj share a handful of targets; each source and file
+    // pair is looked up once.
+    std::unordered_map<uint64_t, const std::filesystem::path*> targets;
     for (const auto& entry : entries)
     {
-        std::filesystem::path iniPath = LocateIniFile(entry, gameRoot, modloaderRoot, cache, missing);
-        if (iniPath.empty())
+        const uint64_t pair = (static_cast<uint64_t>(entry.source) << 32) | entry.iniFile;
+        auto [target, inserted] = targets.emplace(pair, nullptr);
+        if (inserted)
         {
-            continue;
+            auto it = resolved.find(MakeTargetKey(entry));
+            if (it != resolved.end() && !it->second.empty())
+            {
+                target->second = &it->second;
+            }
         }
 
-        grouped[iniPath].push_back(entry);
+        if (target->second != nullptr)
+        {
+            grouped[*target->second].push_back(entry);
+        }
     }
 
     bool didUpdateAnything = false;
@@ -318,53 +795,160 @@ void CInjConfigLoader::Process(const std::filesystem::path& pluginDir)
     if (!didUpdateAnything)
     {
         Logger.Log(std::string(kLogPrefix) + ": no changes written, restoring ini files from /injector.");
-        RestoreIniFilesFromInjector(modloaderRoot);
+        RestoreIniFilesFromInjector();
         return;
     }
 
     Logger.Log(std::string(kLogPrefix) + ": updated " + std::to_string(updatedFiles) + " ini files.");
 }
 
+const std::vector<std::filesystem::path>& CInjConfigLoader::GetPluginInjFiles() const
+{
+    return pluginInjFiles;
+}
+
+const std::vector<std::filesystem::path>& CInjConfigLoader::GetInputFolders() const
+{
+    return inputFolders;
+}
+
+void CInjConfigLoader::UpdateWrittenFolders(const std::vector<std::filesystem::path>& written) const
+{
+    const std::filesystem::path cacheDir = Logger.GetCacheDirectory();
+    if (cacheDir.empty() || written.empty())
+    {
+        return;
+    }
+
+    const std::filesystem::path cachePath = cacheDir / kMissingCacheFileName;
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(cachePath, std::ios::binary);
+        std::string line;
+        while (getline(in, line))
+        {
+            lines.push_back(std::move(line));
+        }
+    }
+
+    // The signature line, then "D <write time> <folder>" and "<seconds> <name>" lines.
+    std::unordered_set<std::string> missing;
+    for (size_t i = 1; i < lines.size(); ++i)
+    {
+        const auto space = lines[i].find(' ');
+        if (!lines[i].starts_with("D ") && space != std::string::npos)
+        {
+            missing.insert(lines[i].substr(space + 1));
+        }
+    }
+
+    if (missing.empty())
+    {
+        return;
+    }
+
+    std::unordered_set<std::string> writtenFolders;
+    for (const auto& path : written)
+    {
+        writtenFolders.insert(ToFolderKey(path.parent_path()));
+    }
+
+    bool updated = false;
+    for (size_t i = 1; i < lines.size(); ++i)
+    {
+        const auto space = lines[i].find(' ', 2);
+        if (!lines[i].starts_with("D ") || space == std::string::npos)
+        {
+            continue;
+        }
+
+        const std::string folder = lines[i].substr(space + 1);
+        const std::filesystem::path folderPath = FromUtf8(folder);
+        if (writtenFolders.count(ToFolderKey(folderPath)) == 0)
+        {
+            continue;
+        }
+
+        std::error_code ec;
+        const int64_t modified = CDirReader::GetModifiedTime(folderPath, ec);
+        if (ec)
+        {
+            continue;
+        }
+
+        // A missing target may have arrived alongside the outputs.
+        if (ContainsAnyName(folderPath, missing))
+        {
+            std::filesystem::remove(cachePath, ec);
+            return;
+        }
+
+        lines[i] = "D " + std::to_string(modified) + " " + folder;
+        updated = true;
+    }
+
+    if (!updated)
+    {
+        return;
+    }
+
+    std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+    for (const auto& line : lines)
+    {
+        out << line << "\n";
+    }
+}
+
 void CInjConfigLoader::CollectInjFiles(const std::filesystem::path& dir, std::vector<std::filesystem::path>& files) const
 {
-    if (dir.empty() || !std::filesystem::exists(dir))
+    if (dir.empty())
     {
         return;
     }
 
-    for (const auto& entry : std::filesystem::directory_iterator(dir))
+    CDirReader reader;
+    reader.Open(dir, false);
+
+    std::vector<std::filesystem::path> subdirs;
+    DirEntryView entry;
+    while (reader.Next(entry))
     {
-        if (entry.is_directory())
+        if (entry.isDirectory)
         {
-            std::string folderName = entry.path().filename().string();
-            if (!folderName.empty() && folderName[0] == '.')
+            if (entry.name.starts_with('.'))
+            {
+                continue;
+            }
+
+            std::filesystem::path subdir = CDirReader::Join(dir, entry.name);
+            if (IsIndexedModloaderRoot(subdir))
             {
                 continue;
             }
-            CollectInjFiles(entry.path(), files);
+            subdirs.push_back(std::move(subdir));
             continue;
         }
 
-        if (!entry.is_regular_file())
+        if (!entry.isRegularFile)
         {
             continue;
         }
 
-        if (entry.path().extension() == ".inj")
+        if (entry.name.size() > 4 && Text::EqualsIgnoreCase(entry.name.substr(entry.name.size() - 4), ".inj"))
         {
-            files.push_back(entry.path());
+            files.push_back(CDirReader::Join(dir, entry.name));
         }
     }
-}
+    reader.Close();
 
-void CInjConfigLoader::ParseFile(const std::filesystem::path& path)
-{
-    std::ifstream in(path);
-    if (!in.is_open())
+    for (const auto& subdir : subdirs)
     {
-        return;
+        CollectInjFiles(subdir, files);
     }
+}
 
+void CInjConfigLoader::ParseFile(uint32_t source, std::vector<InjEntry>& fileEntries, CStringArena& values)
+{
     enum class ParseState
     {
         Modifier,
@@ -377,22 +961,16 @@ void CInjConfigLoader::ParseFile(const std::filesystem::path& path)
     InjModifier modifier = InjModifier::Replace;
     bool inBlock = false;
     bool implicitBlock = false;
-    std::string iniFile;
+    std::string_view iniFile;
     std::string section;
 
-    std::string line;
-    while (getline(in, line))
+    // Values keep their trailing blanks, so lines are trimmed here and not
+    // in the pipeline.
+    CNameCache fileNames(names);
+    CNameCache sectionNames(names);
+    for (std::string_view line : LinePipeline::StripComments(LinePipeline::ReadLines(sources[source])))
     {
-        if (IsCommentOrEmpty(line))
-        {
-            continue;
-        }
-
-        std::string trimmed = Trim(line);
-        if (trimmed.empty())
-        {
-            continue;
-        }
+        const std::string_view trimmed = Text::Trim(line);
 
         if (implicitBlock)
         {
@@ -464,7 +1042,7 @@ void CInjConfigLoader::ParseFile(const std::filesystem::path& path)
             }
 
             const auto equals = line.find('=');
-            if (equals == std::string::npos)
+            if (equals == std::string_view::npos)
             {
                 if (inBlock)
                 {
@@ -479,18 +1057,18 @@ void CInjConfigLoader::ParseFile(const std::filesystem::path& path)
                 break;
             }
 
-            std::string key = Trim(line.substr(0, equals));
-            std::string value = TrimLeft(line.substr(equals + 1));
+            const std::string_view key = Text::Trim(line.substr(0, equals));
+            const std::string_view value = Text::TrimLeft(line.substr(equals + 1));
 
             if (!iniFile.empty() && !section.empty() && !key.empty())
             {
-                entries.push_back({
+                fileEntries.push_back({
                     modifier,
-                    iniFile,
-                    section,
-                    key,
-                    value,
-                    path
+                    source,
+                    fileNames.Get(iniFile),
+                    sectionNames.Get(section),
+                    names.Intern(key),
+                    values.Store(value)
                     });
             }
 
@@ -500,7 +1078,7 @@ void CInjConfigLoader::ParseFile(const std::filesystem::path& path)
             }
             else
             {
-                iniFile.clear();
+                iniFile = {};
                 section.clear();
                 state = ParseState::Modifier;
             }
@@ -508,31 +1086,31 @@ void CInjConfigLoader::ParseFile(const std::filesystem::path& path)
         }
         }
     }
-
-    in.close();
 }
 
 bool CInjConfigLoader::ApplyEntriesToFile(const std::filesystem::path& iniPath, const std::vector<InjEntry>& entries) const
 {
-    std::vector<std::string> lines;
+    // The patch is laid over the base file, so it stays mapped until the
+    // result is written.
+    CMappedFile in;
     std::filesystem::path basePath = GetBasePathFromInjector(iniPath);
-    if (std::filesystem::exists(basePath))
+
+    // Truncating the target would cut the mapped base under the patch.
+    std::error_code ec;
+    if (std::filesystem::equivalent(basePath, iniPath, ec))
     {
-        std::ifstream in(basePath);
-        if (!in.is_open())
-        {
-            return false;
-        }
+        Logger.Log(std::string(kLogPrefix) + ": " + iniPath.string() + " is its own baseline, skipped.");
+        return false;
+    }
 
-        std::string line;
-        while (getline(in, line))
-        {
-            lines.push_back(line);
-        }
-        in.close();
+    if (std::filesystem::exists(basePath) && in.Open(basePath))
+    {
+        return false;
     }
 
-    std::unordered_map<std::string, std::string> mergedValues;
+    CIniPatch patch(in.GetData());
+
+    std::unordered_map<uint64_t, CListMerge> mergedValues;
     mergedValues.reserve(entries.size());
     for (const auto& entry : entries)
     {
@@ -541,207 +1119,186 @@ bool CInjConfigLoader::ApplyEntriesToFile(const std::filesystem::path& iniPath,
             continue;
         }
 
-        std::string key = entry.section + "\n" + entry.key;
-        AppendMergeValue(mergedValues[key], entry.value);
+        const ListMergeMode mode = keepDuplicateKeys.count(entry.key) > 0 ? ListMergeMode::KeepDuplicates : ListMergeMode::Unique;
+        mergedValues.try_emplace(entry.GetSectionKey(), kSpaceList, mode).first->second.Add(entry.value);
     }
 
-    std::unordered_set<std::string> handledMergeKeys;
+    std::unordered_set<uint64_t> handledMergeKeys;
     handledMergeKeys.reserve(mergedValues.size());
 
     bool modified = false;
     for (const auto& entry : entries)
     {
         const bool isMerge = entry.modifier == InjModifier::Merge;
-        if (isMerge)
+        if (isMerge && handledMergeKeys.count(entry.GetSectionKey()) > 0)
         {
-            std::string mergeKey = entry.section + "\n" + entry.key;
-            if (handledMergeKeys.count(mergeKey) > 0)
-            {
-                continue;
-            }
+            continue;
         }
 
-        std::string sectionName = entry.section;
-        size_t sectionStart = lines.size();
-        size_t sectionEnd = lines.size();
+        const std::string_view sectionName = names.GetString(entry.section);
+        const std::string_view entryKey = names.GetString(entry.key);
+        modified = true;
 
-        for (size_t i = 0; i < lines.size(); ++i)
+        const size_t section = patch.FindSection(sectionName);
+        if (section == CIniPatch::npos)
         {
-            std::string currentSection;
-            if (!TryParseSection(lines[i], currentSection))
-            {
-                continue;
-            }
-
-            if (sectionStart != lines.size())
-            {
-                sectionEnd = i;
-                break;
-            }
-
-            if (currentSection == sectionName)
-            {
-                sectionStart = i;
-            }
+            // A new section starts with the entry's own value, Merge or not.
+            patch.AddSection(sectionName, entryKey, entry.value);
+            continue;
         }
 
-        if (sectionStart != lines.size() && sectionEnd == lines.size())
+        std::string_view value = entry.value;
+        if (isMerge)
         {
-            sectionEnd = lines.size();
+            value = mergedValues.at(entry.GetSectionKey()).GetValue();
+            handledMergeKeys.insert(entry.GetSectionKey());
         }
 
-        if (sectionStart == lines.size())
+        if (!patch.SetValue(section, entryKey, value))
         {
-            if (!lines.empty() && !lines.back().empty())
-            {
-                lines.push_back("");
-            }
-
-            lines.push_back("[" + sectionName + "]");
-            lines.push_back(entry.key + "=" + entry.value);
-            modified = true;
-            continue;
+            patch.AddKey(section, entryKey, value);
         }
+    }
 
-        bool keyFound = false;
-        for (size_t i = sectionStart + 1; i < sectionEnd; ++i)
-        {
-            if (IsCommentOrEmpty(lines[i]))
-            {
-                continue;
-            }
+    if (!modified)
+    {
+        return false;
+    }
 
-            const auto equals = lines[i].find('=');
-            if (equals == std::string::npos)
-            {
-                continue;
-            }
+    // Binary, the pieces already carry the file's own line breaks.
+    std::ofstream out(iniPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open() || !patch.Write(out))
+    {
+        return false;
+    }
 
-            std::string key = Trim(lines[i].substr(0, equals));
-            if (key != entry.key)
-            {
-                continue;
-            }
+    out.close();
+    RunManifest.RecordOutput(iniPath);
+    return true;
+}
 
-            size_t valueStart = lines[i].find_first_not_of(" \t", equals + 1);
-            std::string prefix = lines[i].substr(0, equals + 1);
-            std::string spacing;
-            std::string currentValue;
+std::unordered_map<std::string, std::filesystem::path> CInjConfigLoader::ResolveIniFiles(const std::filesystem::path& gameRoot, std::vector<std::filesystem::path>& searchedFolders) const
+{
+    std::unordered_map<std::string, std::filesystem::path> resolved;
+    std::unordered_map<std::string, std::vector<std::string>> pendingByName;
 
-            if (valueStart != std::string::npos)
-            {
-                spacing = lines[i].substr(equals + 1, valueStart - (equals + 1));
-                currentValue = lines[i].substr(valueStart);
-            }
-            else
-            {
-                spacing = "";
-                currentValue = "";
-            }
+    // Cheap checks first: absolute paths, files next to the .inj, then the modloader index.
+    for (const auto& entry : entries)
+    {
+        const std::string targetKey = MakeTargetKey(entry);
+        if (!resolved.emplace(targetKey, std::filesystem::path()).second)
+        {
+            continue;
+        }
 
-            std::string updatedValue = entry.value;
-            if (isMerge)
+        std::error_code ec;
+        std::filesystem::path iniPath(names.GetString(entry.iniFile));
+        if (iniPath.is_absolute())
+        {
+            if (std::filesystem::exists(iniPath, ec))
             {
-                const std::string mergeKey = entry.section + "\n" + entry.key;
-                updatedValue = mergedValues[mergeKey];
-                handledMergeKeys.insert(mergeKey);
+                resolved[targetKey] = iniPath;
             }
-
-            lines[i] = prefix + spacing + updatedValue;
-            keyFound = true;
-            modified = true;
-            break;
+            continue;
         }
 
-        if (!keyFound)
+        std::filesystem::path localPath = sources[entry.source].parent_path() / iniPath;
+        if (std::filesystem::exists(localPath, ec))
         {
-            size_t insertPos = sectionEnd;
-            std::string updatedValue = entry.value;
-            if (isMerge)
-            {
-                const std::string mergeKey = entry.section + "\n" + entry.key;
-                updatedValue = mergedValues[mergeKey];
-                handledMergeKeys.insert(mergeKey);
-            }
+            resolved[targetKey] = localPath;
+            continue;
+        }
 
-            lines.insert(
-                lines.begin() + static_cast<std::vector<std::string>::difference_type>(insertPos),
-                entry.key + "=" + updatedValue
-            );
-            modified = true;
+        const std::string filename = iniPath.filename().string();
+        if (const ModloaderFile* found = ModloaderIndex.FindFirstByName(filename))
+        {
+            resolved[targetKey] = found->path;
+            continue;
         }
+
+        pendingByName[Text::ToLower(filename)].push_back(targetKey);
     }
 
-    if (!modified)
+    if (pendingByName.empty())
     {
-        return false;
+        return resolved;
     }
 
-    std::ofstream out(iniPath, std::ios::trunc);
-    if (!out.is_open())
+    const SearchSettings settings = ReadSearchSettings(gameRoot);
+    const std::string signature = MakeSearchSignature(settings);
+    const std::filesystem::path cacheDir = Logger.GetCacheDirectory();
+    const std::filesystem::path cachePath = cacheDir.empty() ? std::filesystem::path() : cacheDir / kMissingCacheFileName;
+
+    // Names cached as missing stay valid for the folders recorded with them,
+    // so a search that stops early adds its folders to those, never drops any.
+    std::unordered_map<std::string, int64_t> missing;
+    SearchedFolders searched;
+    if (!cachePath.empty())
     {
-        return false;
+        missing = LoadMissingTargets(cachePath, signature, settings.missingCacheHours, searched);
     }
 
-    for (size_t i = 0; i < lines.size(); ++i)
+    std::unordered_set<std::string> wanted;
+    for (const auto& pending : pendingByName)
     {
-        out << lines[i];
-        if (i + 1 < lines.size())
+        if (missing.count(pending.first) > 0)
         {
-            out << "\n";
+            Logger.Log(std::string(kLogPrefix) + ": " + pending.first + " not found on a previous run, skipping search.");
+            continue;
         }
+        wanted.insert(pending.first);
     }
 
-    out.close();
-    return true;
-}
+    // A missing target can turn up in any folder the search read.
+    const auto addSearchedFolders = [&searched, &searchedFolders]()
+        {
+            for (const auto& folder : searched)
+            {
+                searchedFolders.push_back(FromUtf8(folder.first));
+            }
+        };
 
-std::filesystem::path CInjConfigLoader::LocateIniFile(
-    const InjEntry& entry,
-    const std::filesystem::path& gameRoot,
-    const std::filesystem::path& modloaderRoot,
-    std::unordered_map<std::string, std::filesystem::path>& cache,
-    std::unordered_set<std::string>& missing) const
-{
-    const std::string key = entry.iniFile;
-    auto cached = cache.find(key);
-    if (cached != cache.end())
+    if (wanted.empty())
     {
-        return cached->second;
+        addSearchedFolders();
+        return resolved;
     }
 
-    if (missing.count(key))
-    {
-        return {};
-    }
+    Logger.Log(std::string(kLogPrefix) + ": searching for " + std::to_string(wanted.size()) + " unresolved target files.");
+    const auto found = FindFilesByName(settings, wanted, searched);
 
-    std::filesystem::path iniPath(entry.iniFile);
-    if (iniPath.is_absolute() && std::filesystem::exists(iniPath))
+    const int64_t now = NowInSeconds();
+    for (const auto& name : wanted)
     {
-        cache[key] = iniPath;
-        return iniPath;
-    }
+        auto it = found.find(name);
+        if (it == found.end())
+        {
+            Logger.Log(std::string(kLogPrefix) + ": target " + name + " not found.");
+            missing[name] = now;
+            continue;
+        }
 
-    std::filesystem::path localPath = entry.sourcePath.parent_path() / iniPath;
-    if (std::filesystem::exists(localPath))
-    {
-        cache[key] = localPath;
-        return localPath;
+        for (const auto& targetKey : pendingByName[name])
+        {
+            resolved[targetKey] = it->second;
+        }
     }
 
-    const std::string filename = iniPath.filename().string();
-    if (auto found = FindFileByName(modloaderRoot, filename); found.has_value())
+    if (!cachePath.empty())
     {
-        cache[key] = *found;
-        return *found;
+        SaveMissingTargets(cachePath, signature, searched, missing);
     }
 
-    if (auto found = FindFileByName(gameRoot, filename); found.has_value())
+    if (found.size() < pendingByName.size())
     {
-        cache[key] = *found;
-        return *found;
+        addSearchedFolders();
     }
 
-    missing.insert(key);
-    return {};
+    return resolved;
+}
+
+std::string CInjConfigLoader::MakeTargetKey(const InjEntry& entry) const
+{
+    // Relative targets are looked up next to their .inj first, so the source folder is part of the key.
+    return sources[entry.source].parent_path().string() + "\n" + std::string(names.GetString(entry.iniFile));
 }
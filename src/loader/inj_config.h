@@ -1,6 +1,9 @@
 #pragma once
+#include "string_interner.h"
+#include <cstdint>
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -11,14 +14,23 @@ enum class InjModifier
     Merge
 };
 
+// One key=value line of an .inj file. File, section and key are ids in the
+// loader's name table, the value points into the arena of the file it came
+// from and source indexes the loader's list of parsed .inj files.
 struct InjEntry
 {
     InjModifier modifier{};
-    std::string iniFile;
-    std::string section;
-    std::string key;
-    std::string value;
-    std::filesystem::path sourcePath;
+    uint32_t source = 0;
+    CStringInterner::Id iniFile = 0;
+    CStringInterner::Id section = 0;
+    CStringInterner::Id key = 0;
+    std::string_view value;
+
+    // Section and key as one integer, for merge bookkeeping.
+    uint64_t GetSectionKey() const
+    {
+        return (static_cast<uint64_t>(section) << 32) | key;
+    }
 };
 
 class CInjConfigLoader
@@ -26,18 +38,37 @@ class CInjConfigLoader
 public:
     void Process(const std::filesystem::path& pluginDir);
 
+    // .inj files found outside modloader during the last Process() call, and
+    // the folders where a new input would show up as a changed write time:
+    // the plugin folder, the folders holding those .inj files and, while a
+    // target is missing, every folder the target search read.
+    const std::vector<std::filesystem::path>& GetPluginInjFiles() const;
+    const std::vector<std::filesystem::path>& GetInputFolders() const;
+
+    // Outputs written after the target search change the write time of
+    // folders it read. Takes their new time into the missing-target cache,
+    // so the next run does not search again because of its own writes.
+    void UpdateWrittenFolders(const std::vector<std::filesystem::path>& written) const;
+
 private:
     void CollectInjFiles(const std::filesystem::path& dir, std::vector<std::filesystem::path>& files) const;
-    void ParseFile(const std::filesystem::path& path);
+    // Only touches fileEntries, values and the name table, so files can be
+    // parsed concurrently.
+    void ParseFile(uint32_t source, std::vector<InjEntry>& fileEntries, CStringArena& values);
     bool ApplyEntriesToFile(const std::filesystem::path& iniPath, const std::vector<InjEntry>& entries) const;
-    std::filesystem::path LocateIniFile(
-        const InjEntry& entry,
-        const std::filesystem::path& gameRoot,
-        const std::filesystem::path& modloaderRoot,
-        std::unordered_map<std::string, std::filesystem::path>& cache,
-        std::unordered_set<std::string>& missing) const;
+    // Adds the folders searched for targets that are still missing to searchedFolders.
+    std::unordered_map<std::string, std::filesystem::path> ResolveIniFiles(const std::filesystem::path& gameRoot, std::vector<std::filesystem::path>& searchedFolders) const;
+    std::string MakeTargetKey(const InjEntry& entry) const;
 
     std::vector<InjEntry> entries;
+    // What the entries point into: the parsed .inj files, one value arena
+    // per file and the names, which are kept across runs.
+    std::vector<std::filesystem::path> sources;
+    std::vector<CStringArena> valueArenas;
+    CStringInterner names;
+    std::unordered_set<CStringInterner::Id> keepDuplicateKeys;
+    std::vector<std::filesystem::path> pluginInjFiles;
+    std::vector<std::filesystem::path> inputFolders;
 };
 
 extern CInjConfigLoader InjConfigLoader;
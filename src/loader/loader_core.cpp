@@ -10,247 +10,594 @@
 #include "tracks_config.h"
 #include "inj_config.h"
 #include "mva_loader.h"
+#include "modloader_index.h"
+#include "modloader_profile.h"
+#include "run_manifest.h"
+#include "dir_reader.h"
+#include "line_pipeline.h"
+#include "text_utils.h"
+#include "record_schema.h"
 #include "logger.h"
-#include <unordered_set>
+#include "task_pool.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
-
-CompInjector::CompInjector(HINSTANCE pluginHandle)
+namespace
 {
+    const char* kLogPrefix = "CORE";
+    const char* kManifestFileName = "run_manifest.cache";
+
+    // Known FLA data files, keyed by case-folded file name.
+    struct FlaDataFile
+    {
+        std::string_view name;
+        const char* configKey;
+        void (*addLine)(const std::string& line);
+        RecordShapeRule shape;      // .fla lines of any other shape are never offered
+        bool (*parse)(const CRecordLine& line);
+        void (*process)();
+        bool parseWithoutDataFile;  // .fla lines are offered even when no mod ships the data file
+    };
 
-    handle = pluginHandle;
+    constexpr std::array<FlaDataFile, 8> kFlaDataFiles = { {
+        { "gtasa_traintypecarriages.dat", "FLATrainTypeCarriagesLoader",
+            [](const std::string& line) { FLATrainTypeCarriagesLoader.AddLine(line); },
+            CFLATrainTypeCarriagesLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLATrainTypeCarriagesLoader.Parse(line); },
+            []() { FLATrainTypeCarriagesLoader.Process(); }, false },
+        { "model_special_features.dat", "FLAModelSpecialFeaturesLoader",
+            [](const std::string& line) { FLAModelSpecialFeaturesLoader.AddLine(line); },
+            CFLAModelSpecialFeaturesLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLAModelSpecialFeaturesLoader.Parse(line); },
+            []() { FLAModelSpecialFeaturesLoader.Process(); }, false },
+        { "gtasa_melee_config.dat", "FLAMeleeConfigLoader",
+            [](const std::string& line) { FLAMeleeConfigLoader.AddLine(line); },
+            CFLAMeleeConfigLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLAMeleeConfigLoader.Parse(line); },
+            []() { FLAMeleeConfigLoader.Process(); }, false },
+        { "gtasa_radarblipspritefilenames.dat", "FLARadarBlipSpriteFilenamesLoader",
+            [](const std::string& line) { FLARadarBlipSpriteFilenamesLoader.AddLine(line); },
+            CFLARadarBlipSpriteFilenamesLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLARadarBlipSpriteFilenamesLoader.Parse(line); },
+            []() { FLARadarBlipSpriteFilenamesLoader.Process(); }, false },
+        { "gtasa_tracks_config.dat", "FLATracksConfigLoader",
+            [](const std::string& line) { FLATracksConfigLoader.AddLine(line); },
+            CFLATracksConfigLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLATracksConfigLoader.Parse(line); },
+            []() { FLATracksConfigLoader.Process(); }, false },
+        { "cheatstrings.dat", "FLACheatStringsLoader",
+            [](const std::string& line) { FLACheatStringsLoader.AddLine(line); },
+            kAnyRecordShape,
+            [](const CRecordLine& line) { return FLACheatStringsLoader.Parse(line); },
+            []() { FLACheatStringsLoader.Process(); }, false },
+        { "gtasa_vehicleaudiosettings.cfg", "FLAAudioLoader",
+            [](const std::string& line) { FLAAudioLoader.AddLine(line); },
+            CFLAAudioLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLAAudioLoader.Parse(line); },
+            []() { FLAAudioLoader.Process(); }, true },
+        { "gtasa_weapon_config.dat", "FLAWeaponConfigLoader",
+            [](const std::string& line) { FLAWeaponConfigLoader.AddLine(line); },
+            CFLAWeaponConfigLoader::Record::kShapeRule,
+            [](const CRecordLine& line) { return FLAWeaponConfigLoader.Parse(line); },
+            []() { FLAWeaponConfigLoader.Process(); }, true },
+    } };
 
-    ParseModloader();
+    constexpr char FoldCase(char ch)
     {
-        char modulePath[MAX_PATH] = {};
-        std::filesystem::path pluginDir;
-        if (GetModuleFileNameA(handle, modulePath, MAX_PATH) != 0)
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    }
+
+    constexpr uint32_t HashName(std::string_view name, uint32_t seed)
+    {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char ch : name)
         {
-            pluginDir = std::filesystem::path(modulePath).parent_path();
+            hash ^= static_cast<uint8_t>(FoldCase(ch));
+            hash *= 16777619u;
         }
+        return hash;
+    }
 
-        if (!pluginDir.empty())
+    constexpr size_t kFlaSlotCount = 16;
+
+    constexpr bool IsPerfectSeed(uint32_t seed)
+    {
+        std::array<bool, kFlaSlotCount> used{};
+        for (const auto& file : kFlaDataFiles)
         {
-            Logger.Init(pluginDir / "comp.injector.log");
+            const size_t slot = HashName(file.name, seed) % kFlaSlotCount;
+            if (used[slot])
+            {
+                return false;
+            }
+            used[slot] = true;
         }
+        return true;
+    }
 
-        InjConfigLoader.Process(pluginDir);
+    constexpr uint32_t FindPerfectSeed()
+    {
+        uint32_t seed = 0;
+        while (!IsPerfectSeed(seed))
+        {
+            ++seed;
+        }
+        return seed;
     }
 
-    MvaLoader.Process();
+    constexpr uint32_t kFlaSeed = FindPerfectSeed();
 
-    FLAAudioLoader.Process();
-    FLAWeaponConfigLoader.Process();
-    FLAModelSpecialFeaturesLoader.Process();
-    FLATrainTypeCarriagesLoader.Process();
-    FLARadarBlipSpriteFilenamesLoader.Process();
-    FLAMeleeConfigLoader.Process();
-    FLACheatStringsLoader.Process();
-    FLATracksConfigLoader.Process();
-}
+    constexpr std::array<int8_t, kFlaSlotCount> BuildFlaSlots()
+    {
+        std::array<int8_t, kFlaSlotCount> slots{};
+        for (auto& slot : slots)
+        {
+            slot = -1;
+        }
+        for (size_t i = 0; i < kFlaDataFiles.size(); ++i)
+        {
+            slots[HashName(kFlaDataFiles[i].name, kFlaSeed) % kFlaSlotCount] = static_cast<int8_t>(i);
+        }
+        return slots;
+    }
 
+    constexpr std::array<int8_t, kFlaSlotCount> kFlaSlots = BuildFlaSlots();
 
-void CompInjector::ParseModloader()
-{
-    auto isCommentOrEmpty = [](const std::string &line)
+    constexpr bool EqualsFolded(std::string_view left, std::string_view right)
+    {
+        if (left.size() != right.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < left.size(); ++i)
         {
-            const auto firstNonWhitespace = line.find_first_not_of(" \t\r\n");
-            if (firstNonWhitespace == std::string::npos)
+            if (FoldCase(left[i]) != FoldCase(right[i]))
             {
-                return true;
+                return false;
             }
+        }
+        return true;
+    }
 
-            const std::string_view trimmed(line.c_str() + firstNonWhitespace, line.size() - firstNonWhitespace);
+    // Returns the index into kFlaDataFiles, or -1 for any other file.
+    constexpr int FindFlaDataFile(std::string_view name)
+    {
+        const int index = kFlaSlots[HashName(name, kFlaSeed) % kFlaSlotCount];
+        return (index >= 0 && EqualsFolded(kFlaDataFiles[index].name, name)) ? index : -1;
+    }
+
+    static_assert(FindFlaDataFile("gtasa_trainTypeCarriages.dat") == 0);
+    static_assert(FindFlaDataFile("GTASA_WEAPON_CONFIG.DAT") == 7);
+    static_assert(FindFlaDataFile("gtasa_weapon_config.ini") == -1);
 
-            return trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//");
-        };
+    constexpr size_t kStageCount = 2 + kFlaDataFiles.size();
+    static_assert(StageAll == (1u << kStageCount) - 1, "every stage bit needs its own fingerprint");
 
-    auto toLower = [](std::string value)
+    // Everything the loaders read, reduced to stats: file contents are never
+    // opened, an edit is caught by its size or write time. Only the plugin's
+    // own inputs are covered, never the whole game tree: the config, the
+    // reference baselines, the indexed modloader files and the .inj files
+    // outside modloader with the folders they may appear in. There is one
+    // fingerprint per stage bit, over the inputs of that stage, so a stage
+    // whose inputs changed is noticed on its own.
+    std::vector<uint64_t> ComputeStageFingerprints(const std::filesystem::path& pluginModule, const std::filesystem::path& modloaderRoot,
+        const std::vector<std::filesystem::path>& pluginInjFiles, const std::vector<std::filesystem::path>& inputFolders)
+    {
+        // Inputs every stage reads.
+        CFingerprint common;
+        common.AddFile(pluginModule);
+        common.AddFile(gConfig.GetIniPath());
+        common.AddFile(modloaderRoot / "modloader.ini");
+
+        // Reference baselines. Entries are sorted, the listing order is up to the filesystem.
+        std::vector<std::tuple<std::string, uintmax_t, int64_t>> baselines;
+        CDirReader reader;
+        reader.Open(GetInjectorBasePath("gta.dat").parent_path(), true);
+        DirEntryView entry;
+        while (reader.Next(entry))
         {
-            for (char &ch : value)
+            if (entry.isRegularFile)
             {
-                ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+                baselines.emplace_back(std::string(entry.name), entry.size, entry.modified);
             }
-            return value;
-        };
+        }
+        reader.Close();
 
-    std::unordered_set<std::string> modloaderFiles;
-    {
-        std::filesystem::path modloaderRoot = GAME_PATH((char*)"modloader");
-        if (std::filesystem::exists(modloaderRoot))
+        std::sort(baselines.begin(), baselines.end());
+        for (const auto& [name, size, modified] : baselines)
+        {
+            common.Add(name);
+            common.Add(static_cast<int64_t>(size));
+            common.Add(modified);
+        }
+
+        std::vector<CFingerprint> stages(kStageCount, common);
+        CFingerprint& inj = stages[0];
+        CFingerprint& mva = stages[1];
+
+        // INJ targets are found by any file name and MVA targets by .ini
+        // name, so those paths count, and targets appearing or moving are
+        // noticed. Only the files the loaders read get a fresh stat: the
+        // index reuses cached sizes for folders whose own write time did not
+        // change.
+        for (const auto& file : ModloaderIndex.GetFiles())
         {
-            std::filesystem::directory_options options = std::filesystem::directory_options::skip_permission_denied;
-            for (auto it = std::filesystem::recursive_directory_iterator(modloaderRoot, options);
-                it != std::filesystem::recursive_directory_iterator();
-                ++it)
+            const int target = FindFlaDataFile(file.name);
+            if (file.extension == ".inj")
+            {
+                inj.AddFile(file.path);
+            }
+            else if (file.extension == ".mva")
             {
-                if (it->is_directory())
+                mva.AddFile(file.path);
+            }
+            else if (file.extension == ".fla")
+            {
+                for (size_t i = 0; i < kFlaDataFiles.size(); ++i)
                 {
-                    std::string folderName = it->path().filename().string();
-                    if (!folderName.empty() && folderName[0] == '.')
-                    {
-                        it.disable_recursion_pending();
-                    }
-                    continue;
+                    stages[2 + i].AddFile(file.path);
                 }
-
-                if (!it->is_regular_file())
+            }
+            else if (target >= 0)
+            {
+                stages[2 + target].AddFile(file.path);
+            }
+            else
+            {
+                inj.Add(file.path.string());
+                if (file.extension == ".ini")
                 {
-                    continue;
+                    mva.Add(file.path.string());
                 }
+            }
+        }
 
-                modloaderFiles.insert(toLower(it->path().filename().string()));
+        // A new .inj or INJ target outside modloader changes the write time of
+        // the folder it was dropped in. The cache folder is skipped, it
+        // changes on every run that saves an index or manifest.
+        const std::filesystem::path cacheDir = Logger.GetCacheDirectory();
+        for (const auto& folder : inputFolders)
+        {
+            if (folder != cacheDir)
+            {
+                inj.AddFolder(folder);
             }
         }
+        for (const auto& file : pluginInjFiles)
+        {
+            inj.AddFile(file);
+        }
+
+        std::vector<uint64_t> fingerprints;
+        for (const auto& stage : stages)
+        {
+            fingerprints.push_back(stage.Get());
+        }
+        return fingerprints;
+    }
+
+    size_t CountStages(unsigned stages)
+    {
+        return static_cast<size_t>(std::popcount(stages & StageAll));
+    }
+}
+
+
+CompInjector::CompInjector(const std::filesystem::path& pluginModule, size_t workerThreads)
+    : pluginModule(pluginModule), pluginDir(pluginModule.parent_path()), modloaderRoot(GAME_PATH((char*)"modloader"))
+{
+    if (!pluginDir.empty())
+    {
+        Logger.Init(pluginDir / "comp.injector.log");
     }
 
-    const bool hasVehicleAudio = modloaderFiles.count("gtasa_vehicleaudiosettings.cfg") > 0;
-    const bool hasWeaponConfig = modloaderFiles.count("gtasa_weapon_config.dat") > 0;
-    const bool hasModelSpecialFeatures = modloaderFiles.count("model_special_features.dat") > 0;
-    const bool hasTrainTypeCarriages = modloaderFiles.count("gtasa_traintypecarriages.dat") > 0;
-    const bool hasMeleeConfig = modloaderFiles.count("gtasa_melee_config.dat") > 0;
-    const bool hasCheatStrings = modloaderFiles.count("cheatstrings.dat") > 0;
-    const bool hasRadarBlipSprites = modloaderFiles.count("gtasa_radarblipspritefilenames.dat") > 0;
-    const bool hasTracksConfig = modloaderFiles.count("gtasa_tracks_config.dat") > 0;
+    TaskPool.Start(workerThreads);
 
-    std::function<void(const std::filesystem::path&)> traverse;
-    traverse = [&](const std::filesystem::path& dir)
+    // A failing task leaves the index or the outputs incomplete, so nothing
+    // of such a run is saved as current: no index cache, no manifest.
+    try
+    {
+        ModloaderProfile.Load(modloaderRoot / "modloader.ini");
+        ModloaderIndex.Build(modloaderRoot);
+
+        const std::filesystem::path cacheDir = Logger.GetCacheDirectory();
+        manifestPath = cacheDir.empty() ? std::filesystem::path() : cacheDir / kManifestFileName;
+        if (!manifestPath.empty() && RunManifest.Load(manifestPath))
         {
-            for (const auto& entry : std::filesystem::directory_iterator(dir))
+            pluginInjFiles = RunManifest.GetPluginInjFiles();
+            inputFolders = RunManifest.GetInputFolders();
+        }
+
+        // Same inputs and untouched outputs mean the previous run already produced
+        // everything this one would, so no game file is read or written. When
+        // only some stages' inputs changed, only those run.
+        const unsigned stale = GetStaleStages();
+        if (stale == 0)
+        {
+            Logger.Log(std::string(kLogPrefix) + ": inputs unchanged since the last run, nothing to update.");
+            upToDate = true;
+        }
+        else
+        {
+            if (stale != StageAll)
             {
-                if (entry.is_directory())
-                {
-                    std::string folderName = entry.path().filename().string();
-                    if (!folderName.empty() && folderName[0] == '.')
-                    {
-                        continue;
-                    }
-                    traverse(entry.path());
-                    continue;
-                }
-                if (!entry.is_regular_file())
-                {
-                    continue;
-                }
-                std::string ext = entry.path().extension().string();
-                std::string path = entry.path().string();
-                std::string filename = entry.path().filename().string();
+                Logger.Log(std::string(kLogPrefix) + ": inputs of " + std::to_string(CountStages(stale)) + " stages changed since the last run.");
+            }
+            Run(stale);
+        }
+
+        TaskPool.Stop();
+    }
+    catch (const std::exception& e)
+    {
+        Logger.Log(std::string(kLogPrefix) + ": run failed, nothing saved: " + e.what());
+        failed = true;
+        RunManifest.Reset();
+        TaskPool.Stop();
+    }
+}
+
+
+bool CompInjector::IsUpToDate() const
+{
+    return upToDate;
+}
 
-                if (ext == ".fla")
+bool CompInjector::HasFailed() const
+{
+    return failed;
+}
+
+bool CompInjector::IsSavedRunCurrent() const
+{
+    CRunManifest saved;
+    if (manifestPath.empty() || !saved.Load(manifestPath))
+    {
+        return false;
+    }
+
+    return saved.AreOutputsCurrent()
+        && saved.GetStaleStages(ComputeStageFingerprints(pluginModule, modloaderRoot, saved.GetPluginInjFiles(), saved.GetInputFolders())) == 0;
+}
+
+unsigned CompInjector::GetStaleStages() const
+{
+    if (manifestPath.empty() || !RunManifest.AreOutputsCurrent())
+    {
+        return StageAll;
+    }
+    return RunManifest.GetStaleStages(ComputeStageFingerprints(pluginModule, modloaderRoot, pluginInjFiles, inputFolders));
+}
+
+void CompInjector::Refresh(unsigned stages)
+{
+    failed = false;
+    try
+    {
+        ModloaderProfile.Load(modloaderRoot / "modloader.ini");
+        ModloaderIndex.Build(modloaderRoot);
+        Run(stages);
+    }
+    catch (const std::exception& e)
+    {
+        Logger.Log(std::string(kLogPrefix) + ": refresh failed, nothing saved: " + e.what());
+        failed = true;
+        RunManifest.Reset();
+    }
+}
+
+void CompInjector::Run(unsigned stages)
+{
+    RunManifest.BeginRun();
+
+    // The saved fingerprints have to describe the outputs on disk, so a stage
+    // left out whose inputs changed anyway runs as well: one no watcher
+    // noticed, or one whose input folders the other stages just wrote to.
+    if (!manifestPath.empty())
+    {
+        stages |= GetStaleStages();
+    }
+
+    unsigned ran = 0;
+    std::vector<uint64_t> fingerprints;
+    while (stages != 0)
+    {
+        RunStages(stages);
+        ran |= stages;
+
+        const std::vector<std::filesystem::path> written = RunManifest.GetOutputs();
+        ModloaderIndex.UpdateWrittenFolders(written);
+        InjConfigLoader.UpdateWrittenFolders(written);
+
+        if (manifestPath.empty())
+        {
+            return;
+        }
+
+        fingerprints = ComputeStageFingerprints(pluginModule, modloaderRoot, pluginInjFiles, inputFolders);
+        stages = RunManifest.GetStaleStages(fingerprints) & StageAll & ~ran;
+        if (stages != 0)
+        {
+            Logger.Log(std::string(kLogPrefix) + ": inputs of " + std::to_string(CountStages(stages)) + " more stages changed, running them as well.");
+        }
+    }
+
+    // Nothing was stale and nothing asked for: the saved run is still current.
+    if (ran != 0)
+    {
+        RunManifest.Save(manifestPath, fingerprints, pluginInjFiles, inputFolders, ran == StageAll);
+    }
+}
+
+void CompInjector::RunStages(unsigned stages)
+{
+    ParseModloader(stages);
+
+    if (stages & StageInj)
+    {
+        InjConfigLoader.Process(pluginDir);
+        pluginInjFiles = InjConfigLoader.GetPluginInjFiles();
+        inputFolders = InjConfigLoader.GetInputFolders();
+    }
+
+    if (stages & StageMva)
+    {
+        MvaLoader.Process();
+    }
+
+    for (size_t i = 0; i < kFlaDataFiles.size(); ++i)
+    {
+        if (stages & (StageFlaFirst << i))
+        {
+            kFlaDataFiles[i].process();
+        }
+    }
+}
+
+unsigned CompInjector::GetAffectedStages(const std::filesystem::path& path, bool isDirectory)
+{
+    // A mod folder appearing, disappearing or being renamed changes the index itself.
+    if (isDirectory)
+    {
+        return StageAll;
+    }
+
+    const std::string name = Text::ToLower(path.filename().string());
+    const std::string_view extension = std::string_view(name).substr(std::min(name.size(), name.rfind('.')));
+
+    if (name == "comp.injector.ini" || name == "modloader.ini")
+    {
+        return StageAll;
+    }
+
+    const int target = FindFlaDataFile(name);
+    if (target >= 0)
+    {
+        return StageFlaFirst << target;
+    }
+
+    if (extension == ".fla")
+    {
+        return StageFla;
+    }
+    if (extension == ".mva")
+    {
+        return StageMva;
+    }
+    if (extension == ".inj")
+    {
+        return StageInj;
+    }
+    if (extension == ".ini")
+    {
+        // Any .ini may be an INJ target; the ModelVariations ones are MVA targets as well.
+        return name.starts_with("modelvariations_") ? (StageInj | StageMva) : StageInj;
+    }
+
+    return 0;
+}
+
+void CompInjector::ParseModloader(unsigned stages)
+{
+    // A loader takes .fla lines when its stage runs and it either always does
+    // or some mod ships its data file; .dat/.cfg lines when its stage runs and
+    // it is switched on in the config.
+    std::array<bool, kFlaDataFiles.size()> parseFla{};
+    std::array<bool, kFlaDataFiles.size()> enabled{};
+    bool anyFla = false;
+    for (size_t i = 0; i < kFlaDataFiles.size(); ++i)
+    {
+        const bool selected = (stages & (StageFlaFirst << i)) != 0;
+        parseFla[i] = selected && (kFlaDataFiles[i].parseWithoutDataFile || ModloaderIndex.Contains(kFlaDataFiles[i].name));
+        enabled[i] = selected && gConfig.ReadInteger("MAIN", kFlaDataFiles[i].configKey, 1) == 1;
+        anyFla = anyFla || parseFla[i] || enabled[i];
+    }
+
+    if (!anyFla)
+    {
+        return;
+    }
+
+    std::array<size_t, kFlaDataFiles.size()> flaTables{};
+    size_t flaTableCount = 0;
+    for (size_t i = 0; i < kFlaDataFiles.size(); ++i)
+    {
+        if (parseFla[i])
+        {
+            flaTables[flaTableCount++] = i;
+        }
+    }
+
+    std::array<size_t, kFlaDataFiles.size()> flaTaken{};
+    size_t flaLines = 0;
+    size_t flaUnmatched = 0;
+    size_t flaAmbiguous = 0;
+
+    // The loaders take std::string lines from data files; one buffer serves
+    // every line.
+    std::string lineBuffer;
+    for (const auto& file : ModloaderIndex.GetFiles())
+    {
+        const std::string& ext = file.extension;
+
+        if (ext == ".fla")
+        {
+            // Comments only count at the very start of the line here. Each
+            // line is tokenized and classified once; only the tables whose
+            // shape rule fits get to look at it.
+            const auto isContent = [](std::string_view line)
                 {
-                    std::ifstream in(path);
-                    std::string line;
-                    while (getline(in, line))
-                    {
-                        if (line.starts_with(";") || line.starts_with("//") || line.starts_with("#"))
-                        {
-                            continue;
-                        }
-                        FLAAudioLoader.Parse(line);
-                        FLAWeaponConfigLoader.Parse(line);
-                        if (hasModelSpecialFeatures)
-                        {
-                            FLAModelSpecialFeaturesLoader.Parse(line);
-                        }
-                        if (hasTrainTypeCarriages)
-                        {
-                            FLATrainTypeCarriagesLoader.Parse(line);
-                        }
-                        if (hasRadarBlipSprites)
-                        {
-                            FLARadarBlipSpriteFilenamesLoader.Parse(line);
-                        }
-                        if (hasMeleeConfig)
-                        {
-                            FLAMeleeConfigLoader.Parse(line);
-                        }
-                        if (hasCheatStrings)
-                        {
-                            FLACheatStringsLoader.Parse(line);
-                        }
-                        if (hasTracksConfig)
-                        {
-                            FLATracksConfigLoader.Parse(line);
-                        }
-                    }
-                    in.close();
-                }
-                else if (ext == ".dat" || ext == ".cfg")
+                    return !(line.starts_with(";") || line.starts_with("//") || line.starts_with("#"));
+                };
+            for (const CRecordLine& record : LinePipeline::Classify(LinePipeline::Filter(LinePipeline::ReadLines(file.path), isContent)))
+            {
+                size_t takenBy = 0;
+                for (size_t i = 0; i < flaTableCount; ++i)
                 {
-                    std::ifstream in(path);
-                    if (!in.is_open())
-                    {
-                        continue;
-                    }
-
-                    std::string line;
-                    while (getline(in, line))
+                    const FlaDataFile& table = kFlaDataFiles[flaTables[i]];
+                    if (table.shape.Matches(record.GetShape()) && table.parse(record))
                     {
-                        if (isCommentOrEmpty(line))
-                        {
-                            continue;
-                        }
-
-                        if (filename == "gtasa_trainTypeCarriages.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLATrainTypeCarriagesLoader", 1) == 1)
-                            {
-                                FLATrainTypeCarriagesLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "model_special_features.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLAModelSpecialFeaturesLoader", 1) == 1)
-                            {
-                                FLAModelSpecialFeaturesLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "gtasa_melee_config.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLAMeleeConfigLoader", 1) == 1)
-                            {
-                                FLAMeleeConfigLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "gtasa_radarBlipSpriteFilenames.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLARadarBlipSpriteFilenamesLoader", 1) == 1)
-                            {
-                                FLARadarBlipSpriteFilenamesLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "gtasa_tracks_config.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLATracksConfigLoader", 1) == 1)
-                            {
-                                FLATracksConfigLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "cheatStrings.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLACheatStringsLoader", 1) == 1)
-                            {
-                                FLACheatStringsLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "gtasa_vehicleAudioSettings.cfg")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLAAudioLoader", 1) == 1)
-                            {
-                                FLAAudioLoader.AddLine(line);
-                            }
-                        }
-                        else if (filename == "gtasa_weapon_config.dat")
-                        {
-                            if (gConfig.ReadInteger("MAIN", "FLAWeaponConfigLoader", 1) == 1)
-                            {
-                                FLAWeaponConfigLoader.AddLine(line);
-                            }
-                        }
+                        ++flaTaken[flaTables[i]];
+                        ++takenBy;
                     }
-                    in.close();
                 }
+
+                ++flaLines;
+                flaUnmatched += takenBy == 0 ? 1 : 0;
+                flaAmbiguous += takenBy > 1 ? 1 : 0;
             }
-        };
+        }
+        else if (ext == ".dat" || ext == ".cfg")
+        {
+            // The target table and its switch are resolved once per file; files
+            // of disabled loaders are never opened.
+            const int target = FindFlaDataFile(file.name);
+            if (target < 0 || !enabled[target])
+            {
+                continue;
+            }
+
+            for (std::string_view line : LinePipeline::StripComments(LinePipeline::ReadLines(file.path)))
+            {
+                lineBuffer.assign(line);
+                kFlaDataFiles[target].addLine(lineBuffer);
+            }
+        }
+    }
 
-    traverse(GAME_PATH((char*)"modloader"));
+    if (flaLines > 0)
+    {
+        std::string routing;
+        for (size_t i = 0; i < flaTableCount; ++i)
+        {
+            routing += (i == 0 ? "" : ", ") + std::string(kFlaDataFiles[flaTables[i]].configKey) + " " + std::to_string(flaTaken[flaTables[i]]);
+        }
+        Logger.Log(std::string(kLogPrefix) + ": routed " + std::to_string(flaLines) + " .fla lines (" + routing + "), " +
+            std::to_string(flaAmbiguous) + " taken by more than one table, " + std::to_string(flaUnmatched) + " by none");
+    }
 }
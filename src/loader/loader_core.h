@@ -1,14 +1,58 @@
 #pragma once
-#include <wtypes.h>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+// Parts of the pipeline a refresh can be limited to. FLA data file i of the
+// routing table owns bit (StageFlaFirst << i).
+enum InjectorStage : unsigned
+{
+    StageInj = 1u << 0,
+    StageMva = 1u << 1,
+    StageFlaFirst = 1u << 2,
+    StageFla = 0xFFu << 2,
+    StageAll = StageInj | StageMva | StageFla,
+};
 
 class CompInjector
 {
 private:
-    HINSTANCE handle;
+    std::filesystem::path pluginModule;
+    std::filesystem::path pluginDir;
+    std::filesystem::path modloaderRoot;
+    std::filesystem::path manifestPath;
+    std::vector<std::filesystem::path> pluginInjFiles;
+    std::vector<std::filesystem::path> inputFolders;
+    bool upToDate = false;
+    bool failed = false;
 
     bool IsPluginNameValid();
-    void ParseModloader();
+    // StageAll when an output changed or no manifest can be kept.
+    unsigned GetStaleStages() const;
+    void ParseModloader(unsigned stages);
+    // Runs stages and every other stage whose inputs changed, then saves the manifest.
+    void Run(unsigned stages);
+    void RunStages(unsigned stages);
 
 public:
-    CompInjector(HINSTANCE pluginHandle);
+    // Runs the whole pipeline. pluginModule is the COMP.Injector.asi path,
+    // the log, cache and reference folders live next to it.
+    CompInjector(const std::filesystem::path& pluginModule, size_t workerThreads);
+
+    // True when the previous run's outputs were still current and nothing was written.
+    bool IsUpToDate() const;
+    // True when the last run or refresh threw; its outputs may be incomplete
+    // and nothing of it was saved.
+    bool HasFailed() const;
+
+    // Rebuilds the modloader index and regenerates the given stages, plus
+    // any other stage whose inputs changed since the last saved run.
+    void Refresh(unsigned stages);
+
+    // True when a fresh start would find the saved run current, i.e. the
+    // plugin will skip all loaders on the next launch.
+    bool IsSavedRunCurrent() const;
+
+    // Stages whose outputs depend on the given input file or folder, 0 for unrelated files.
+    static unsigned GetAffectedStages(const std::filesystem::path& path, bool isDirectory);
 };
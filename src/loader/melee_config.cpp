@@ -1,7 +1,10 @@
 #include "pch.h"
 #include "melee_config.h"
 #include "logger.h"
-#include <unordered_set>
+#include "run_manifest.h"
+#include "line_reader.h"
+#include "text_utils.h"
+#include "record_merge.h"
 
 CFLAMeleeConfigLoader FLAMeleeConfigLoader;
 
@@ -17,22 +20,8 @@ namespace
 
     bool HasMarker(const std::string& settingsPath)
     {
-        std::ifstream in(settingsPath);
-        if (!in.is_open())
-        {
-            return false;
-        }
-
-        std::string line;
-        while (getline(in, line))
-        {
-            if (line.find(kMarker) != std::string::npos)
-            {
-                return true;
-            }
-        }
-
-        return false;
+        CMappedFile in;
+        return !in.Open(settingsPath) && in.GetData().find(kMarker) != std::string_view::npos;
     }
 }
 
@@ -42,18 +31,6 @@ void CFLAMeleeConfigLoader::UpdateMeleeConfigFile()
     std::filesystem::path settingsPathTemp = settingsPath;
     settingsPathTemp += ".tmp";
     std::filesystem::path basePath = GetBasePathFromInjector(settingsPath);
-    auto isCommentOrEmpty = [](const std::string &value)
-        {
-            const auto firstNonWhitespace = value.find_first_not_of(" \t\r\n");
-            if (firstNonWhitespace == std::string::npos)
-            {
-                return true;
-            }
-
-            const std::string_view trimmed(value.c_str() + firstNonWhitespace, value.size() - firstNonWhitespace);
-
-            return trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//");
-        };
 
     if (!std::filesystem::exists(basePath))
     {
@@ -63,34 +40,43 @@ void CFLAMeleeConfigLoader::UpdateMeleeConfigFile()
 
     if (store.empty())
     {
-        std::ifstream in(basePath, std::ios::binary);
+        CMappedFile in;
+        in.Open(basePath);
         std::ofstream out(settingsPathTemp, std::ios::binary | std::ios::trunc);
-        if (!in.is_open() || !out.is_open())
+        if (!in.IsOpen() || !out.is_open())
         {
             return;
         }
 
-        out << in.rdbuf();
-        in.close();
+        const std::string_view base = in.GetData();
+        out.write(base.data(), static_cast<std::streamsize>(base.size()));
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": refreshed " + settingsPath.string());
         return;
     }
 
-    std::unordered_set<std::string> writtenLines;
-    std::unordered_set<std::string> existingLines;
+    // Keyed by melee id.
+    CRecordMerge rows(RecordKeyKind::Int, &Record::Key);
+    for (const auto& e : store)
+    {
+        rows.Add(e);
+    }
 
-    std::ifstream in(basePath);
+    CMappedFile in;
+    in.Open(basePath);
     std::ofstream out(settingsPathTemp);
 
-    if (in.is_open() && out.is_open())
+    if (in.IsOpen() && out.is_open())
     {
-        std::string line;
+        CLineReader reader(in.GetData());
+        std::string_view line;
         bool ignoreLines = false;
-        while (getline(in, line))
+        while (reader.Next(line))
         {
             if (line.find(kMarker) != std::string::npos)
             {
@@ -103,41 +89,37 @@ void CFLAMeleeConfigLoader::UpdateMeleeConfigFile()
                 continue;
             }
 
-            if (isCommentOrEmpty(line))
+            if (Text::IsCommentOrEmpty(line))
             {
                 out << line << "\n";
                 continue;
             }
 
-            out << line << "\n";
-            existingLines.insert(line);
+            std::string_view row;
+            if (rows.TakeBaseRow(line, row))
+            {
+                out << row << "\n";
+            }
         }
 
         out << kMarker << "\n";
 
-        for (const auto &e : store)
+        for (const std::string_view row : rows.GetAddedRows())
         {
-            if (existingLines.count(e) > 0)
-            {
-                continue;
-            }
-
-            if (writtenLines.insert(e).second)
-            {
-                out << e << "\n";
-            }
+            out << row << "\n";
         }
 
-        in.close();
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": updated " + settingsPath.string());
     }
     else
     {
-        if (in.is_open()) in.close();
+        if (in.IsOpen()) in.Close();
         if (out.is_open()) out.close();
     }
 }
@@ -152,6 +134,8 @@ void CFLAMeleeConfigLoader::Process()
 
     Logger.Log(std::string(kLogPrefix) + ": processing melee config.");
     UpdateMeleeConfigFile();
+
+    store.clear();
 }
 
 void CFLAMeleeConfigLoader::AddLine(const std::string &line)
@@ -159,15 +143,16 @@ void CFLAMeleeConfigLoader::AddLine(const std::string &line)
     store.push_back(line);
 }
 
-void CFLAMeleeConfigLoader::Parse(const std::string &line)
+bool CFLAMeleeConfigLoader::Parse(const CRecordLine &line)
 {
+    Record::Values record;
     int index = 0;
-    char name[256] = {};
 
-    int count = sscanf(line.c_str(), "%d %255s", &index, name);
-
-    if (count == 2 && index > 4 && strnlen(name, sizeof(name)) > 0)
+    if (!Record::Match(line, record) || !RecordText::ParseInt(record[0], index) || index <= 4)
     {
-        store.push_back(line);
+        return false;
     }
+
+    store.emplace_back(line.GetText());
+    return true;
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "record_schema.h"
 #include <vector>
 
 class CFLAModelSpecialFeaturesLoader
@@ -8,8 +9,12 @@ private:
     void UpdateModelSpecialFeaturesFile();
 
 public:
+    // model, feature
+    using Record = CRecordSchema<RecordField::Token, RecordField::Token>;
+
     void AddLine(const std::string &line);
-    void Parse(const std::string &line);
+    // Takes the line when it is a record of this table.
+    bool Parse(const CRecordLine &line);
     void Process();
 };
 
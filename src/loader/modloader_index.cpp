@@ -0,0 +1,471 @@
+#include "pch.h"
+#include "modloader_index.h"
+#include "text_utils.h"
+#include "logger.h"
+#include "task_pool.h"
+#include "dir_reader.h"
+#include "modloader_profile.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+CModloaderIndex ModloaderIndex;
+
+namespace
+{
+    const char* kLogPrefix = "INDEX";
+    const char* kCacheFileName = "modloader_index.cache";
+    const char* kCacheHeader = "comp.injector modloader index 2";
+
+    bool IsHiddenFolder(std::string_view name)
+    {
+        return !name.empty() && name[0] == '.';
+    }
+
+    std::string ToUtf8(const std::filesystem::path& path)
+    {
+        const std::u8string value = path.generic_u8string();
+        return std::string(value.begin(), value.end());
+    }
+
+    std::filesystem::path FromUtf8(const std::string& value)
+    {
+        return std::filesystem::path(std::u8string(value.begin(), value.end()));
+    }
+
+    std::string JoinRelative(const std::string& parent, const std::string& child)
+    {
+        return parent.empty() ? child : parent + "/" + child;
+    }
+}
+
+void CModloaderIndex::Build(const std::filesystem::path& modloaderRoot)
+{
+    root = modloaderRoot;
+    cachePath.clear();
+    dirs.clear();
+    files.clear();
+    byName.clear();
+    byExtension.clear();
+    byMod.clear();
+    built = true;
+
+    std::error_code ec;
+    if (root.empty() || !std::filesystem::is_directory(root, ec))
+    {
+        Logger.Log(std::string(kLogPrefix) + ": modloader folder not found, index is empty.");
+        return;
+    }
+
+    const std::filesystem::path cacheDir = Logger.GetCacheDirectory();
+    cachePath = cacheDir.empty() ? std::filesystem::path() : cacheDir / kCacheFileName;
+
+    DirMap previous;
+    if (!cachePath.empty() && LoadCache(cachePath, previous))
+    {
+        Logger.Log(std::string(kLogPrefix) + ": loaded " + std::to_string(previous.size()) + " cached folders.");
+    }
+
+    // The result tree keeps the sorted on-disk order regardless of which
+    // thread scanned which folder.
+    const size_t previousCount = previous.size();
+    std::atomic<size_t> rescanned{ 0 };
+    ScanNode scanRoot;
+    CTaskGroup scans(TaskPool);
+    scans.Submit([this, &scanRoot, &previous, &rescanned, &scans]()
+        {
+            Scan(scanRoot, previous, rescanned, scans);
+        });
+    scans.Wait();
+
+    Collect(scanRoot, dirs);
+
+    // Disabled mods are not scanned, their cached folders are kept as they
+    // were so enabling a mod again only reads what changed meanwhile.
+    const auto& mods = dirs[{}].subdirs;
+    for (auto& [relDir, record] : previous)
+    {
+        const std::string mod = relDir.substr(0, relDir.find('/'));
+        if (!relDir.empty() && std::binary_search(mods.begin(), mods.end(), mod) && !ModloaderProfile.IsModEnabled(FromUtf8(mod).string()))
+        {
+            dirs.emplace(relDir, std::move(record));
+        }
+    }
+
+    Flatten(dirs, {}, {});
+
+    size_t skippedMods = 0;
+    for (const auto& mod : dirs[{}].subdirs)
+    {
+        if (!ModloaderProfile.IsModEnabled(FromUtf8(mod).string()))
+        {
+            ++skippedMods;
+        }
+    }
+
+    if (skippedMods > 0)
+    {
+        Logger.Log(std::string(kLogPrefix) + ": skipped " + std::to_string(skippedMods) + " mods disabled in modloader.ini.");
+    }
+    Logger.Log(std::string(kLogPrefix) + ": indexed " + std::to_string(files.size()) + " files in "
+        + std::to_string(dirs.size()) + " folders (" + std::to_string(rescanned.load()) + " rescanned) under " + root.string());
+
+    if (!cachePath.empty() && (rescanned > 0 || dirs.size() != previousCount))
+    {
+        SaveCache(cachePath, dirs);
+    }
+}
+
+void CModloaderIndex::UpdateWrittenFolders(const std::vector<std::filesystem::path>& written)
+{
+    if (cachePath.empty() || dirs.empty())
+    {
+        return;
+    }
+
+    size_t updated = 0;
+    for (const auto& path : written)
+    {
+        const std::filesystem::path relDir = path.parent_path().lexically_relative(root);
+        if (relDir.empty() || *relDir.begin() == "..")
+        {
+            continue;
+        }
+
+        const std::string key = relDir == "." ? std::string() : ToUtf8(relDir);
+        auto it = dirs.find(key);
+        if (it == dirs.end())
+        {
+            continue;
+        }
+
+        std::error_code ec;
+        const int64_t modified = CDirReader::GetModifiedTime(ToFullPath(key), ec);
+        if (ec || modified == it->second.modified)
+        {
+            continue;
+        }
+
+        // Read again rather than only taking the new time, so anything else
+        // that changed in the folder meanwhile is not hidden from the cache.
+        CachedDir record;
+        ReadDirectory(ToFullPath(key), record);
+        record.modified = modified;
+        it->second = std::move(record);
+        ++updated;
+    }
+
+    if (updated > 0)
+    {
+        SaveCache(cachePath, dirs);
+    }
+}
+
+void CModloaderIndex::Scan(ScanNode& node, DirMap& previous, std::atomic<size_t>& rescanned, CTaskGroup& scans) const
+{
+    const std::filesystem::path dir = ToFullPath(node.relDir);
+
+    std::error_code ec;
+    const int64_t modified = CDirReader::GetModifiedTime(dir, ec);
+
+    // Each task only looks up its own folder, so the map is never modified concurrently.
+    auto cached = previous.find(node.relDir);
+    if (!ec && cached != previous.end() && cached->second.modified == modified)
+    {
+        node.record = std::move(cached->second);
+    }
+    else
+    {
+        ReadDirectory(dir, node.record);
+        // A failed stat stores 0 so the folder is enumerated again next time.
+        node.record.modified = ec ? 0 : modified;
+        ++rescanned;
+    }
+
+    node.children.reserve(node.record.subdirs.size());
+    for (const auto& subdir : node.record.subdirs)
+    {
+        // Mods disabled in modloader.ini are never descended into. Build()
+        // keeps their cached folders, so toggling a mod does not force a rescan.
+        if (node.relDir.empty() && !ModloaderProfile.IsModEnabled(FromUtf8(subdir).string()))
+        {
+            continue;
+        }
+
+        auto child = std::make_unique<ScanNode>();
+        child->relDir = JoinRelative(node.relDir, subdir);
+        ScanNode* childPtr = child.get();
+        node.children.push_back(std::move(child));
+        scans.Submit([this, childPtr, &previous, &rescanned, &scans]()
+            {
+                Scan(*childPtr, previous, rescanned, scans);
+            });
+    }
+}
+
+void CModloaderIndex::Collect(ScanNode& node, DirMap& current) const
+{
+    current[node.relDir] = std::move(node.record);
+    for (auto& child : node.children)
+    {
+        Collect(*child, current);
+    }
+}
+
+void CModloaderIndex::ReadDirectory(const std::filesystem::path& dir, CachedDir& record) const
+{
+    CDirReader reader;
+    reader.Open(dir, true);
+
+    DirEntryView entry;
+    while (reader.Next(entry))
+    {
+        if (entry.isDirectory)
+        {
+            if (!IsHiddenFolder(entry.name))
+            {
+                record.subdirs.emplace_back(entry.name);
+            }
+            continue;
+        }
+
+        if (!entry.isRegularFile)
+        {
+            continue;
+        }
+
+        CachedFile file;
+        file.name.assign(entry.name);
+        file.size = entry.size;
+        file.modified = entry.modified;
+        record.files.push_back(std::move(file));
+    }
+
+    if (reader.GetError())
+    {
+        Logger.Log(std::string(kLogPrefix) + ": failed to read " + dir.string() + ": " + reader.GetError().message());
+    }
+
+    // Entries are sorted so the index order does not depend on the filesystem.
+    std::sort(record.subdirs.begin(), record.subdirs.end());
+    std::sort(record.files.begin(), record.files.end(), [](const CachedFile& left, const CachedFile& right)
+        {
+            return left.name < right.name;
+        });
+}
+
+void CModloaderIndex::Flatten(const DirMap& dirs, const std::string& relDir, const std::string& modName)
+{
+    auto it = dirs.find(relDir);
+    if (it == dirs.end())
+    {
+        return;
+    }
+
+    const std::filesystem::path dir = ToFullPath(relDir);
+    for (const auto& file : it->second.files)
+    {
+        AddFile(dir / FromUtf8(file.name), file, modName);
+    }
+
+    for (const auto& subdir : it->second.subdirs)
+    {
+        // Cached folders of disabled mods stay in dirs but are not indexed.
+        if (relDir.empty() && !ModloaderProfile.IsModEnabled(FromUtf8(subdir).string()))
+        {
+            continue;
+        }
+
+        Flatten(dirs, JoinRelative(relDir, subdir), modName.empty() ? FromUtf8(subdir).string() : modName);
+    }
+}
+
+bool CModloaderIndex::LoadCache(const std::filesystem::path& cachePath, DirMap& dirs) const
+{
+    std::ifstream in(cachePath, std::ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    if (!getline(in, line) || line != kCacheHeader)
+    {
+        return false;
+    }
+
+    // The cache is only valid for the modloader folder it was built from.
+    if (!getline(in, line) || line != "R " + ToUtf8(root))
+    {
+        return false;
+    }
+
+    // D <modified> <relative folder>
+    // S <subfolder name>
+    // F <size> <modified> <file name>
+    CachedDir* current = nullptr;
+    while (getline(in, line))
+    {
+        if (line.size() < 2 || line[1] != ' ')
+        {
+            dirs.clear();
+            return false;
+        }
+
+        std::istringstream stream(line.substr(2));
+        if (line[0] == 'D')
+        {
+            int64_t modified = 0;
+            stream >> modified;
+            stream.get();
+            std::string relDir;
+            getline(stream, relDir);
+            current = &dirs[relDir];
+            current->modified = modified;
+        }
+        else if (line[0] == 'S' && current != nullptr)
+        {
+            current->subdirs.push_back(line.substr(2));
+        }
+        else if (line[0] == 'F' && current != nullptr)
+        {
+            CachedFile file;
+            stream >> file.size >> file.modified;
+            stream.get();
+            getline(stream, file.name);
+            current->files.push_back(std::move(file));
+        }
+        else
+        {
+            dirs.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CModloaderIndex::SaveCache(const std::filesystem::path& cachePath, const DirMap& dirs) const
+{
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        Logger.Log(std::string(kLogPrefix) + ": failed to write " + tempPath.string());
+        return;
+    }
+
+    out << kCacheHeader << "\n";
+    out << "R " << ToUtf8(root) << "\n";
+    for (const auto& dir : dirs)
+    {
+        out << "D " << dir.second.modified << " " << dir.first << "\n";
+        for (const auto& subdir : dir.second.subdirs)
+        {
+            out << "S " << subdir << "\n";
+        }
+        for (const auto& file : dir.second.files)
+        {
+            out << "F " << file.size << " " << file.modified << " " << file.name << "\n";
+        }
+    }
+    out.close();
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec)
+    {
+        Logger.Log(std::string(kLogPrefix) + ": failed to save " + cachePath.string() + ": " + ec.message());
+    }
+}
+
+std::filesystem::path CModloaderIndex::ToFullPath(const std::string& relPath) const
+{
+    return relPath.empty() ? root : root / FromUtf8(relPath);
+}
+
+void CModloaderIndex::AddFile(const std::filesystem::path& path, const CachedFile& cached, const std::string& modName)
+{
+    const size_t index = files.size();
+    ModloaderFile file;
+    file.path = path;
+    file.name = Text::ToLower(path.filename().string());
+    file.extension = Text::ToLower(path.extension().string());
+    file.modName = modName;
+    file.size = cached.size;
+    file.modified = cached.modified;
+
+    byName[file.name].push_back(index);
+    byExtension[file.extension].push_back(index);
+    if (!modName.empty())
+    {
+        byMod[Text::ToLower(modName)].push_back(index);
+    }
+
+    files.push_back(std::move(file));
+}
+
+bool CModloaderIndex::IsBuilt() const
+{
+    return built;
+}
+
+const std::filesystem::path& CModloaderIndex::GetRoot() const
+{
+    return root;
+}
+
+const std::vector<ModloaderFile>& CModloaderIndex::GetFiles() const
+{
+    return files;
+}
+
+bool CModloaderIndex::Contains(std::string_view name) const
+{
+    return byName.count(Text::ToLower(name)) > 0;
+}
+
+const ModloaderFile* CModloaderIndex::FindFirstByName(std::string_view name) const
+{
+    auto it = byName.find(Text::ToLower(name));
+    if (it == byName.end() || it->second.empty())
+    {
+        return nullptr;
+    }
+
+    return &files[it->second.front()];
+}
+
+std::vector<const ModloaderFile*> CModloaderIndex::FindByName(std::string_view name) const
+{
+    return Lookup(byName, Text::ToLower(name));
+}
+
+std::vector<const ModloaderFile*> CModloaderIndex::FindByExtension(std::string_view extension) const
+{
+    return Lookup(byExtension, Text::ToLower(extension));
+}
+
+std::vector<const ModloaderFile*> CModloaderIndex::FindByMod(std::string_view modName) const
+{
+    return Lookup(byMod, Text::ToLower(modName));
+}
+
+std::vector<const ModloaderFile*> CModloaderIndex::Lookup(const IndexMap& map, const std::string& key) const
+{
+    std::vector<const ModloaderFile*> result;
+    auto it = map.find(key);
+    if (it == map.end())
+    {
+        return result;
+    }
+
+    result.reserve(it->second.size());
+    for (size_t index : it->second)
+    {
+        result.push_back(&files[index]);
+    }
+    return result;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class CTaskGroup;
+
+struct ModloaderFile
+{
+    std::filesystem::path path;
+    std::string name;       // lowercase file name
+    std::string extension;  // lowercase extension, including the dot
+    std::string modName;    // top-level folder under modloader, empty for files in the root
+    uintmax_t size = 0;     // size and write time as of the last enumeration of the folder,
+    int64_t modified = 0;   // see CModloaderIndex for when they are stale
+};
+
+// One recursive walk of the modloader tree per launch. Every loader queries
+// this index instead of walking the disk on its own.
+//
+// Every folder is scanned as a separate task on the shared task pool. The
+// scan result is persisted in the cache directory. On the next launch a
+// folder is only enumerated again when its own write time changed, so an
+// unchanged tree costs one stat per folder.
+//
+// Editing a file in place changes neither the set of names nor the folder's
+// write time, so such a file keeps the size and write time of the last
+// enumeration. The file list is always exact; whoever needs current metadata,
+// like the run manifest fingerprints, stats the file itself.
+class CModloaderIndex
+{
+public:
+    void Build(const std::filesystem::path& modloaderRoot);
+    // Outputs replaced inside the tree change the write time of their
+    // folders. Those folders are read again and the cache saved, so the next
+    // launch does not rescan exactly the folders this one wrote to.
+    void UpdateWrittenFolders(const std::vector<std::filesystem::path>& written);
+
+    bool IsBuilt() const;
+    const std::filesystem::path& GetRoot() const;
+    const std::vector<ModloaderFile>& GetFiles() const;
+
+    bool Contains(std::string_view name) const;
+    const ModloaderFile* FindFirstByName(std::string_view name) const;
+    std::vector<const ModloaderFile*> FindByName(std::string_view name) const;
+    std::vector<const ModloaderFile*> FindByExtension(std::string_view extension) const;
+    std::vector<const ModloaderFile*> FindByMod(std::string_view modName) const;
+
+private:
+    struct CachedFile
+    {
+        std::string name;
+        uintmax_t size = 0;
+        int64_t modified = 0;
+    };
+
+    struct CachedDir
+    {
+        int64_t modified = 0;
+        std::vector<std::string> subdirs;
+        std::vector<CachedFile> files;
+    };
+
+    // Keyed by the folder path relative to the root, '/'-separated, UTF-8.
+    using DirMap = std::unordered_map<std::string, CachedDir>;
+
+    struct ScanNode
+    {
+        std::string relDir;
+        CachedDir record;
+        std::vector<std::unique_ptr<ScanNode>> children;
+    };
+
+    using IndexMap = std::unordered_map<std::string, std::vector<size_t>>;
+
+    bool LoadCache(const std::filesystem::path& cachePath, DirMap& dirs) const;
+    void SaveCache(const std::filesystem::path& cachePath, const DirMap& dirs) const;
+    void Scan(ScanNode& node, DirMap& previous, std::atomic<size_t>& rescanned, CTaskGroup& scans) const;
+    void Collect(ScanNode& node, DirMap& current) const;
+    void ReadDirectory(const std::filesystem::path& dir, CachedDir& record) const;
+    void Flatten(const DirMap& dirs, const std::string& relDir, const std::string& modName);
+    void AddFile(const std::filesystem::path& path, const CachedFile& cached, const std::string& modName);
+    std::filesystem::path ToFullPath(const std::string& relPath) const;
+    std::vector<const ModloaderFile*> Lookup(const IndexMap& map, const std::string& key) const;
+
+    std::filesystem::path root;
+    std::filesystem::path cachePath;
+    DirMap dirs;
+    std::vector<ModloaderFile> files;
+    IndexMap byName;
+    IndexMap byExtension;
+    IndexMap byMod;
+    bool built = false;
+};
+
+extern CModloaderIndex ModloaderIndex;
@@ -0,0 +1,186 @@
+#include "pch.h"
+#include "modloader_profile.h"
+#include "logger.h"
+#include "line_reader.h"
+#include "text_utils.h"
+
+CModloaderProfile ModloaderProfile;
+
+namespace
+{
+    const char* kLogPrefix = "PROFILE";
+
+    bool ParseBool(const std::string& value)
+    {
+        const std::string lowered = Text::ToLower(value);
+        return lowered == "true" || lowered == "1" || lowered == "yes";
+    }
+
+    // Case-insensitive glob with '*' and '?', the patterns modloader accepts for mod names.
+    bool MatchGlob(std::string_view name, std::string_view pattern)
+    {
+        size_t n = 0;
+        size_t p = 0;
+        size_t starPattern = std::string_view::npos;
+        size_t starName = 0;
+        while (n < name.size())
+        {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+            {
+                ++n;
+                ++p;
+            }
+            else if (p < pattern.size() && pattern[p] == '*')
+            {
+                starPattern = p++;
+                starName = n;
+            }
+            else if (starPattern != std::string_view::npos)
+            {
+                p = starPattern + 1;
+                n = ++starName;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        while (p < pattern.size() && pattern[p] == '*')
+        {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    std::vector<std::string> ReadKeys(linb::ini_nocase& ini, const std::string& section)
+    {
+        std::vector<std::string> keys;
+        auto it = ini.find(section);
+        if (it == ini.end())
+        {
+            return keys;
+        }
+
+        for (const auto& kv : it->second)
+        {
+            keys.push_back(Text::ToLower(kv.first));
+        }
+        return keys;
+    }
+}
+
+void CModloaderProfile::Load(const std::filesystem::path& modloaderIni)
+{
+    profileName = "Default";
+    excludeAllMods = false;
+    ignoreMods.clear();
+    includeMods.clear();
+    exclusiveMods.clear();
+    priorities.clear();
+
+    std::error_code ec;
+    if (!std::filesystem::exists(modloaderIni, ec))
+    {
+        Logger.Log(std::string(kLogPrefix) + ": modloader.ini not found, every mod is enabled.");
+        return;
+    }
+
+    // modloader ignores case in section and mod names. Reading them the same
+    // way makes "MyMod" and "mymod" one key whose first value wins, instead
+    // of two keys that would fold into one priority in iteration order.
+    linb::ini_nocase ini;
+    CMappedFile in;
+    if (in.Open(modloaderIni) || !ini.read_buffer(in.GetData()))
+    {
+        Logger.Log(std::string(kLogPrefix) + ": failed to read modloader.ini.");
+        return;
+    }
+
+    const std::string selected = ini.get("Folder.Config", "Profile", "");
+    if (!selected.empty())
+    {
+        profileName = selected;
+    }
+
+    const std::string prefix = "Profiles." + profileName + ".";
+    excludeAllMods = ParseBool(ini.get(prefix + "Config", "ExcludeAllMods", "false"));
+    ignoreMods = ReadKeys(ini, prefix + "IgnoreMods");
+    includeMods = ReadKeys(ini, prefix + "IncludeMods");
+    exclusiveMods = ReadKeys(ini, prefix + "ExclusiveMods");
+
+    auto section = ini.find(prefix + "Priority");
+    if (section != ini.end())
+    {
+        for (const auto& kv : section->second)
+        {
+            try
+            {
+                priorities[Text::ToLower(kv.first)] = std::stoi(kv.second, nullptr, 10);
+            }
+            catch (const std::exception&)
+            {
+                Logger.Log(std::string(kLogPrefix) + ": invalid priority for mod " + kv.first);
+            }
+        }
+    }
+
+    Logger.Log(std::string(kLogPrefix) + ": profile " + profileName + ", "
+        + std::to_string(ignoreMods.size()) + " ignored, "
+        + std::to_string(includeMods.size()) + " included, "
+        + std::to_string(exclusiveMods.size()) + " exclusive, "
+        + std::to_string(priorities.size()) + " priorities"
+        + (excludeAllMods ? ", all other mods excluded." : "."));
+}
+
+bool CModloaderProfile::IsModEnabled(std::string_view modName) const
+{
+    const std::string name = Text::ToLower(modName);
+
+    if (!exclusiveMods.empty())
+    {
+        return MatchesAny(exclusiveMods, name);
+    }
+
+    if (MatchesAny(ignoreMods, name))
+    {
+        return false;
+    }
+
+    // modloader ignores mods whose priority is set to 0.
+    auto priority = priorities.find(name);
+    if (priority != priorities.end() && priority->second == 0)
+    {
+        return false;
+    }
+
+    if (excludeAllMods)
+    {
+        return MatchesAny(includeMods, name);
+    }
+
+    return true;
+}
+
+int CModloaderProfile::GetPriority(std::string_view modName, int defaultValue) const
+{
+    auto it = priorities.find(Text::ToLower(modName));
+    return it != priorities.end() ? it->second : defaultValue;
+}
+
+size_t CModloaderProfile::GetPriorityCount() const
+{
+    return priorities.size();
+}
+
+bool CModloaderProfile::MatchesAny(const std::vector<std::string>& patterns, const std::string& name)
+{
+    for (const auto& pattern : patterns)
+    {
+        if (MatchGlob(name, pattern))
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Active profile of modloader.ini, read once before anything is scanned.
+// Mods that modloader itself will not load are skipped by every walker.
+class CModloaderProfile
+{
+public:
+    void Load(const std::filesystem::path& modloaderIni);
+
+    bool IsModEnabled(std::string_view modName) const;
+    int GetPriority(std::string_view modName, int defaultValue) const;
+    size_t GetPriorityCount() const;
+
+private:
+    static bool MatchesAny(const std::vector<std::string>& patterns, const std::string& name);
+
+    std::string profileName;
+    bool excludeAllMods = false;
+    std::vector<std::string> ignoreMods;
+    std::vector<std::string> includeMods;
+    std::vector<std::string> exclusiveMods;
+    std::unordered_map<std::string, int> priorities;  // keyed by lowercase mod name
+};
+
+extern CModloaderProfile ModloaderProfile;
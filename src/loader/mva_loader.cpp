@@ -1,82 +1,49 @@
 ﻿#include "pch.h"
 #include "mva_loader.h"
 #include "logger.h"
+#include "run_manifest.h"
+#include "line_pipeline.h"
+#include "text_utils.h"
+#include "modloader_index.h"
+#include "modloader_profile.h"
+#include "task_pool.h"
+#include "list_merge.h"
 #include <fstream>
-#include <sstream>
 #include <unordered_map>
 #include <unordered_set>
-#include <algorithm> // Potrzebne dla std::transform jeśli ToLower byłoby inne, ale tu mamy własne
+#include <algorithm>
+#include <queue>
+#include <span>
 
 CMvaLoader MvaLoader;
 
 namespace
 {
-    std::string ToLower(std::string value)
-    {
-        for (char& ch : value)
-        {
-            ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
-        }
-        return value;
-    }
-
-    std::string ToUpper(std::string value)
+    std::filesystem::path GetBasePathFromInjector(const std::filesystem::path& iniPath)
     {
-        for (char& ch : value)
-        {
-            ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
-        }
-        return value;
+        return GetInjectorBasePath(iniPath);
     }
 
-
-    bool IsHiddenFolder(const std::filesystem::path& path)
+    // --- SEKCJE ---
+    bool IsSectionHeader(std::string_view line)
     {
-        std::string folderName = path.filename().string();
-        return !folderName.empty() && folderName[0] == '.';
+        return line.size() >= 2 && line.front() == '[' && line.back() == ']';
     }
 
-    std::vector<std::string> SplitSectionNames(const std::string& section)
+    // --- KLUCZE I WARTOŚCI ---
+    // False for lines without '=' or with an empty key.
+    bool SplitKeyValue(std::string_view line, std::string_view& key, std::string_view& value)
     {
-        std::vector<std::string> names;
-        std::string current;
-        for (char ch : section)
+        const auto equals = Text::FindChar(line, '=');
+        if (equals == std::string_view::npos)
         {
-            if (ch == ',')
-            {
-                if (!current.empty())
-                {
-                    size_t start = current.find_first_not_of(" \t\r\n");
-                    size_t end = current.find_last_not_of(" \t\r\n");
-                    if (start != std::string::npos && end != std::string::npos)
-                    {
-                        names.push_back(current.substr(start, end - start + 1));
-                    }
-                }
-                current.clear();
-            }
-            else
-            {
-                current.push_back(ch);
-            }
-        }
-
-        if (!current.empty())
-        {
-            size_t start = current.find_first_not_of(" \t\r\n");
-            size_t end = current.find_last_not_of(" \t\r\n");
-            if (start != std::string::npos && end != std::string::npos)
-            {
-                names.push_back(current.substr(start, end - start + 1));
-            }
+            return false;
         }
 
-        return names;
-    }
-
-    std::filesystem::path GetBasePathFromInjector(const std::filesystem::path& iniPath)
-    {
-        return GetInjectorBasePath(iniPath);
+        // UWAGA: Usunięto ToLower(key) -> Klucze są teraz Case-Sensitive (np. RecursiveVariations)
+        key = Text::TrimRight(line.substr(0, equals));
+        value = Text::TrimLeft(line.substr(equals + 1));
+        return !key.empty();
     }
 
     const std::unordered_set<std::string> kForceReplaceKeys = {
@@ -140,33 +107,11 @@ namespace
     };
 }
 
-void RestoreIniFilesFromInjector(const std::filesystem::path& modloaderRoot)
+void RestoreIniFilesFromInjector()
 {
-    std::filesystem::directory_options options = std::filesystem::directory_options::skip_permission_denied;
-    for (auto it = std::filesystem::recursive_directory_iterator(modloaderRoot, options);
-        it != std::filesystem::recursive_directory_iterator();
-        ++it)
+    for (const ModloaderFile* file : ModloaderIndex.FindByExtension(".ini"))
     {
-        if (it->is_directory())
-        {
-            if (IsHiddenFolder(it->path()))
-            {
-                it.disable_recursion_pending();
-            }
-            continue;
-        }
-
-        if (!it->is_regular_file())
-        {
-            continue;
-        }
-
-        const std::filesystem::path iniPath = it->path();
-        if (ToLower(iniPath.extension().string()) != ".ini")
-        {
-            continue;
-        }
-
+        const std::filesystem::path& iniPath = file->path;
         std::filesystem::path injectorPath = GetBasePathFromInjector(iniPath);
         if (!std::filesystem::exists(injectorPath))
         {
@@ -176,6 +121,7 @@ void RestoreIniFilesFromInjector(const std::filesystem::path& modloaderRoot)
         try
         {
             std::filesystem::copy_file(injectorPath, iniPath, std::filesystem::copy_options::overwrite_existing);
+            RunManifest.RecordOutput(iniPath);
             Logger.Log("MVA: restored " + iniPath.string() + " from " + injectorPath.string());
         }
         catch (const std::exception&)
@@ -198,13 +144,12 @@ void CMvaLoader::Process()
     Logger.Log(std::string("MVA: scanning modloader at ") + modloaderRoot.string());
 
     std::vector<MvaFileEntry> entries;
-    CollectMvaFiles(modloaderRoot, entries);
+    CollectMvaFiles(entries);
 
     if (entries.empty())
     {
         Logger.Log("MVA: no .mva files found.");
 
-        std::unordered_map<std::string, std::filesystem::path> originalIniCache;
         const std::vector<std::string> kRestoreNames = {
             "ModelVariations_Peds.ini",
             "ModelVariations_PedWeapons.ini",
@@ -214,7 +159,7 @@ void CMvaLoader::Process()
 
         for (const auto& name : kRestoreNames)
         {
-            std::filesystem::path originalIni = FindOriginalIni(modloaderRoot, name, originalIniCache);
+            std::filesystem::path originalIni = FindOriginalIni(name);
             if (originalIni.empty())
             {
                 continue;
@@ -229,6 +174,7 @@ void CMvaLoader::Process()
             try
             {
                 std::filesystem::copy_file(injectorPath, originalIni, std::filesystem::copy_options::overwrite_existing);
+                RunManifest.RecordOutput(originalIni);
                 Logger.Log("MVA: restored " + originalIni.string() + " from " + injectorPath.string());
             }
             catch (const std::exception&)
@@ -242,18 +188,29 @@ void CMvaLoader::Process()
 
     Logger.Log("MVA: found " + std::to_string(entries.size()) + " .mva files.");
 
-    const std::filesystem::path modloaderIni = modloaderRoot / "modloader.ini";
-    std::unordered_map<std::string, int> priorities = LoadPriorities(modloaderIni);
-    Logger.Log("MVA: loaded " + std::to_string(priorities.size()) + " mod priorities.");
+    if (forceReplaceKeys.empty())
+    {
+        for (const auto& key : kForceReplaceKeys)
+        {
+            forceReplaceKeys.insert(names.Intern(key));
+        }
+    }
+
+    // [MVA] KeepDuplicates: ','-separated keys whose merged lists keep every
+    // element, e.g. to weight a model by listing it twice.
+    keepDuplicateKeys.clear();
+    const std::string keepDuplicates = gConfig.ReadString("MVA", "KeepDuplicates", "");
+    for (const std::string_view key : Text::SplitTrimmed(keepDuplicates, ','))
+    {
+        keepDuplicateKeys.insert(names.Intern(key));
+    }
+
+    Logger.Log("MVA: using " + std::to_string(ModloaderProfile.GetPriorityCount()) + " mod priorities.");
 
     std::unordered_map<std::string, std::vector<MvaFileEntry>> grouped;
     for (auto& entry : entries)
     {
-        auto it = priorities.find(entry.modName);
-        if (it != priorities.end())
-        {
-            entry.priority = it->second;
-        }
+        entry.priority = ModloaderProfile.GetPriority(entry.modName, 0);
 
         std::filesystem::path targetFilename = entry.sourcePath.filename();
         targetFilename.replace_extension(".ini");
@@ -263,8 +220,20 @@ void CMvaLoader::Process()
 
     Logger.Log("MVA: grouped into " + std::to_string(grouped.size()) + " target files.");
 
-    bool didUpdateAnything = false;
-    std::unordered_map<std::string, std::filesystem::path> originalIniCache;
+    // Every base is read and every source indexed up front, in parallel
+    // across all targets and priorities; only the merge fold below runs in
+    // order. A target's sorted sources start at firstSource.
+    struct TargetPlan
+    {
+        const std::string* name;
+        std::vector<MvaFileEntry>* files;
+        std::filesystem::path originalIni;
+        std::filesystem::path basePath;
+        size_t firstSource;
+    };
+
+    std::vector<TargetPlan> plans;
+    std::vector<std::filesystem::path> sourcePaths;
     for (auto& group : grouped)
     {
         auto& files = group.second;
@@ -279,7 +248,7 @@ void CMvaLoader::Process()
                 return left.sourcePath.string() < right.sourcePath.string();
             });
 
-        std::filesystem::path originalIni = FindOriginalIni(modloaderRoot, group.first, originalIniCache);
+        std::filesystem::path originalIni = FindOriginalIni(group.first);
         if (originalIni.empty())
         {
             Logger.Log("MVA: original ini not found for " + group.first);
@@ -295,35 +264,65 @@ void CMvaLoader::Process()
             continue;
         }
 
-        IniData finalData = ReadIniData(basePath);
+        plans.push_back({ &group.first, &files, std::move(originalIni), std::move(basePath), sourcePaths.size() });
+        for (const auto& file : files)
+        {
+            sourcePaths.push_back(file.sourcePath);
+        }
+    }
+
+    // Sources stay mapped, not parsed: what is held in memory is the bases
+    // and the section being decided.
+    std::vector<IniData> bases(plans.size());
+    std::vector<SourceIndex> sources(sourcePaths.size());
+    TaskPool.ParallelFor(plans.size() + sourcePaths.size(), [&](size_t i)
+        {
+            if (i < plans.size())
+            {
+                bases[i] = ReadIniData(plans[i].basePath);
+            }
+            else
+            {
+                IndexSections(sourcePaths[i - plans.size()], sources[i - plans.size()]);
+            }
+        });
+
+    bool didUpdateAnything = false;
+    for (size_t planIndex = 0; planIndex < plans.size(); ++planIndex)
+    {
+        const TargetPlan& plan = plans[planIndex];
+        const std::string& targetName = *plan.name;
+        const auto& files = *plan.files;
+        const std::filesystem::path& originalIni = plan.originalIni;
+        IniData finalData = std::move(bases[planIndex]);
 
-        size_t index = 0;
-        while (index < files.size())
+        for (size_t index = 0; index < files.size(); ++index)
         {
-            const int priority = files[index].priority;
-            Logger.Log("MVA: merging priority " + std::to_string(priority));
-            IniData mergedData;
-            while (index < files.size() && files[index].priority == priority)
+            if (index == 0 || files[index].priority != files[index - 1].priority)
             {
-                IniData content = ReadIniData(files[index].sourcePath);
-                Logger.Log("MVA: reading " + files[index].sourcePath.string());
-                MergeIniData(mergedData, content);
-                ++index;
+                Logger.Log("MVA: merging priority " + std::to_string(files[index].priority));
             }
+            Logger.Log("MVA: reading " + files[index].sourcePath.string());
+        }
 
-            ReplaceIniData(finalData, mergedData);
+        const std::span<SourceIndex> targetSources(sources.data() + plan.firstSource, files.size());
+        MergeSources(finalData, files, targetSources);
+        for (SourceIndex& source : targetSources)
+        {
+            source.spans.clear();
+            source.file.Close();
         }
 
         if (finalData.empty())
         {
-            Logger.Log("MVA: final content empty for " + group.first + ", skipping write.");
+            Logger.Log("MVA: final content empty for " + targetName + ", skipping write.");
             continue;
         }
 
         std::string finalContent = WriteIniData(finalData);
         if (finalContent.empty())
         {
-            Logger.Log("MVA: no ini data to write for " + group.first);
+            Logger.Log("MVA: no ini data to write for " + targetName);
             continue;
         }
 
@@ -344,6 +343,7 @@ void CMvaLoader::Process()
         {
             std::filesystem::remove(originalIni);
             std::filesystem::rename(tempPath, originalIni);
+            RunManifest.RecordOutput(originalIni);
             Logger.Log("MVA: updated " + originalIni.string() + " using /injector base");
             didUpdateAnything = true;
         }
@@ -353,6 +353,8 @@ void CMvaLoader::Process()
         }
     }
 
+    Logger.Log("MVA: " + std::to_string(names.GetCount()) + " distinct section and key names interned.");
+
     if (!didUpdateAnything)
     {
         Logger.Log("MVA: nothing updated from .mva files, restoring known INIs from /injector when available.");
@@ -366,7 +368,7 @@ void CMvaLoader::Process()
 
         for (const auto& name : kRestoreNames)
         {
-            std::filesystem::path originalIni = FindOriginalIni(modloaderRoot, name, originalIniCache);
+            std::filesystem::path originalIni = FindOriginalIni(name);
             if (originalIni.empty())
             {
                 continue;
@@ -381,6 +383,7 @@ void CMvaLoader::Process()
             try
             {
                 std::filesystem::copy_file(injectorPath, originalIni, std::filesystem::copy_options::overwrite_existing);
+                RunManifest.RecordOutput(originalIni);
                 Logger.Log("MVA: restored " + originalIni.string() + " from " + injectorPath.string());
             }
             catch (const std::exception&)
@@ -391,318 +394,351 @@ void CMvaLoader::Process()
     }
 }
 
-void CMvaLoader::CollectMvaFiles(const std::filesystem::path& modloaderRoot, std::vector<MvaFileEntry>& entries) const
+void CMvaLoader::CollectMvaFiles(std::vector<MvaFileEntry>& entries) const
 {
-    for (const auto& entry : std::filesystem::directory_iterator(modloaderRoot))
+    for (const ModloaderFile* file : ModloaderIndex.FindByExtension(".mva"))
     {
-        if (entry.is_directory())
+        // Only files inside a mod folder take part; modloader's root holds no mods.
+        if (file->modName.empty())
         {
-            if (IsHiddenFolder(entry.path()))
-            {
-                continue;
-            }
-
-            for (auto it = std::filesystem::recursive_directory_iterator(entry.path());
-                it != std::filesystem::recursive_directory_iterator();
-                ++it)
-            {
-                if (it->is_directory())
-                {
-                    if (IsHiddenFolder(it->path()))
-                    {
-                        it.disable_recursion_pending();
-                        continue;
-                    }
-                    continue;
-                }
-
-                if (!it->is_regular_file())
-                {
-                    continue;
-                }
-
-                if (ToLower(it->path().extension().string()) == ".mva")
-                {
-                    std::filesystem::path relativePath = std::filesystem::relative(it->path(), modloaderRoot);
-                    auto relIt = relativePath.begin();
-                    if (relIt == relativePath.end())
-                    {
-                        continue;
-                    }
-
-                    std::string modName = relIt->string();
-                    if (modName.empty())
-                    {
-                        continue;
-                    }
-
-                    Logger.Log("MVA: found " + it->path().string() + " in mod " + modName);
-                    entries.push_back({ it->path(), modName, 0 });
-                }
-            }
+            continue;
         }
+
+        Logger.Log("MVA: found " + file->path.string() + " in mod " + file->modName);
+        entries.push_back({ file->path, file->modName, 0 });
     }
 }
 
-std::unordered_map<std::string, int> CMvaLoader::LoadPriorities(const std::filesystem::path& modloaderIni) const
+std::filesystem::path CMvaLoader::FindOriginalIni(const std::string& filename) const
 {
-    std::unordered_map<std::string, int> priorities;
-    if (!std::filesystem::exists(modloaderIni))
-    {
-        Logger.Log("MVA: modloader.ini not found, default priorities assumed.");
-        return priorities;
-    }
-
-    linb::ini ini;
-    if (!ini.load_file(modloaderIni.string()))
+    for (const ModloaderFile* file : ModloaderIndex.FindByName(filename))
     {
-        Logger.Log("MVA: failed to read modloader.ini.");
-        return priorities;
+        if (file->extension == ".ini")
+        {
+            return file->path;
+        }
     }
 
-    auto section = ini.find("Profiles.Default.Priority");
-    if (section == ini.end())
-    {
-        Logger.Log("MVA: Profiles.Default.Priority section not found.");
-        return priorities;
-    }
+    return {};
+}
 
-    for (const auto& kv : section->second)
+CMvaLoader::IniData CMvaLoader::ReadIniData(const std::filesystem::path& path)
+{
+    IniData data;
+    std::vector<NameId> currentSections;
+    for (std::string_view trimmedLine : LinePipeline::ContentLines(path))
     {
-        try
+        if (IsSectionHeader(trimmedLine))
         {
-            int value = std::stoi(kv.second, nullptr, 10);
-            priorities[kv.first] = value;
+            ReadSectionNames(trimmedLine, currentSections);
+            continue;
         }
-        catch (const std::exception&)
+
+        std::string_view key;
+        std::string_view value;
+        if (currentSections.empty() || !SplitKeyValue(trimmedLine, key, value))
         {
-            Logger.Log("MVA: invalid priority for mod " + kv.first);
             continue;
         }
+
+        const NameId keyId = names.Intern(key);
+        for (const NameId sectionId : currentSections)
+        {
+            data[sectionId][keyId] = value;
+        }
     }
 
-    return priorities;
+    return data;
 }
 
-std::filesystem::path CMvaLoader::FindOriginalIni(
-    const std::filesystem::path& modloaderRoot,
-    const std::string& filename,
-    std::unordered_map<std::string, std::filesystem::path>& cache) const
+void CMvaLoader::IndexSections(const std::filesystem::path& path, SourceIndex& source)
 {
-    auto cached = cache.find(filename);
-    if (cached != cache.end())
+    if (source.file.Open(path))
     {
-        return cached->second;
+        return;
     }
 
-    std::filesystem::directory_options options = std::filesystem::directory_options::skip_permission_denied;
-    for (auto it = std::filesystem::recursive_directory_iterator(modloaderRoot, options);
-        it != std::filesystem::recursive_directory_iterator();
-        ++it)
-    {
-        if (it->is_directory())
+    // A body opens at the first key under a header and is extended to every
+    // later one, so a header without keys holds no section, as in
+    // ReadIniData().
+    std::vector<NameId> currentSections;
+    const char* bodyStart = nullptr;
+    const char* bodyEnd = nullptr;
+    const auto closeBody = [&]()
         {
-            if (IsHiddenFolder(it->path()))
+            if (bodyStart != nullptr)
             {
-                it.disable_recursion_pending();
-                continue;
+                for (const NameId sectionId : currentSections)
+                {
+                    source.spans.push_back({ sectionId, std::string_view(bodyStart, static_cast<size_t>(bodyEnd - bodyStart)) });
+                }
+                bodyStart = nullptr;
             }
-            continue;
-        }
+        };
 
-        if (!it->is_regular_file())
+    for (std::string_view line : LinePipeline::TrimLines(LinePipeline::StripComments(LinePipeline::SplitLines(source.file.GetData()))))
+    {
+        if (IsSectionHeader(line))
         {
+            closeBody();
+            ReadSectionNames(line, currentSections);
             continue;
         }
 
-        if (it->path().filename().string() == filename && ToLower(it->path().extension().string()) == ".ini")
+        std::string_view key;
+        std::string_view value;
+        if (!currentSections.empty() && SplitKeyValue(line, key, value))
         {
-            cache[filename] = it->path();
-            return it->path();
+            if (bodyStart == nullptr)
+            {
+                bodyStart = line.data();
+            }
+            bodyEnd = line.data() + line.size();
         }
     }
+    closeBody();
 
-    cache[filename] = std::filesystem::path();
-    return {};
+    std::stable_sort(source.spans.begin(), source.spans.end(), [](const SectionSpan& left, const SectionSpan& right)
+        {
+            return left.section < right.section;
+        });
 }
 
-CMvaLoader::IniData CMvaLoader::ReadIniData(const std::filesystem::path& path) const
+CMvaLoader::IniSection CMvaLoader::ReadSection(std::span<const SectionSpan> spans)
 {
-    std::ifstream in(path);
-    if (!in.is_open())
+    // Later keys replace earlier ones, across headers too, as in
+    // ReadIniData().
+    IniSection section;
+    for (const SectionSpan& span : spans)
     {
-        return {};
+        for (std::string_view line : LinePipeline::TrimLines(LinePipeline::StripComments(LinePipeline::SplitLines(span.body))))
+        {
+            std::string_view key;
+            std::string_view value;
+            if (SplitKeyValue(line, key, value))
+            {
+                section[names.Intern(key)] = value;
+            }
+        }
     }
+    return section;
+}
 
-    IniData data;
-    std::string line;
-    std::vector<std::string> currentSections;
-    while (getline(in, line))
+void CMvaLoader::ReadSectionNames(std::string_view header, std::vector<NameId>& sections)
+{
+    const std::vector<std::string_view> rawSections = Text::SplitTrimmed(header.substr(1, header.size() - 2), ',');
+    sections.clear();
+
+    for (const auto& rawSec : rawSections)
     {
-        const auto firstNonWhitespace = line.find_first_not_of(" \t\r\n");
-        if (firstNonWhitespace == std::string::npos)
+        // Jeśli to "Settings" (bez względu na wielkość liter), zachowaj oryginał
+        if (Text::EqualsIgnoreCase(rawSec, "settings"))
         {
-            continue;
+            sections.push_back(names.Intern(rawSec));
         }
-
-        const std::string_view trimmed(line.c_str() + firstNonWhitespace, line.size() - firstNonWhitespace);
-        if (trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//"))
+        else
         {
-            continue;
+            // Reszta sekcji -> WIELKIE LITERY
+            sections.push_back(names.Intern(Text::ToUpper(rawSec)));
         }
+    }
+}
 
-        std::string trimmedLine = line;
-        trimmedLine.erase(0, firstNonWhitespace);
-        trimmedLine.erase(trimmedLine.find_last_not_of(" \t\r\n") + 1);
-
-        // --- SEKCJE ---
-        if (trimmedLine.size() >= 2 && trimmedLine.front() == '[' && trimmedLine.back() == ']')
+void CMvaLoader::MergeSources(IniData& target, const std::vector<MvaFileEntry>& files, std::span<const SourceIndex> sources)
+{
+    // The sorted section spans of all sources are walked together, smallest
+    // section id first. Ties pop in source order, which is priority order,
+    // so the last holder of a section names the bucket that wins it.
+    struct Cursor
+    {
+        NameId section;
+        size_t source;
+    };
+    const auto later = [](const Cursor& left, const Cursor& right)
         {
-            std::string sectionName = trimmedLine.substr(1, trimmedLine.size() - 2);
-            std::vector<std::string> rawSections = SplitSectionNames(sectionName);
-            currentSections.clear();
-
-            for (const auto& rawSec : rawSections)
-            {
-                // Jeśli to "Settings" (bez względu na wielkość liter), zachowaj oryginał
-                if (ToLower(rawSec) == "settings")
-                {
-                    currentSections.push_back(rawSec);
-                }
-                else
-                {
-                    // Reszta sekcji -> WIELKIE LITERY
-                    currentSections.push_back(ToUpper(rawSec));
-                }
-            }
-            continue;
-        }
+            return left.section != right.section ? left.section > right.section : left.source > right.source;
+        };
 
-        // --- KLUCZE I WARTOŚCI ---
-        const auto equals = trimmedLine.find('=');
-        if (equals == std::string::npos || currentSections.empty())
+    std::vector<size_t> next(sources.size(), 0);
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        if (!sources[i].spans.empty())
         {
-            continue;
+            heap.push({ sources[i].spans[0].section, i });
         }
+    }
 
-        std::string key = trimmedLine.substr(0, equals);
-        key.erase(key.find_last_not_of(" \t\r\n") + 1);
+    std::vector<std::pair<size_t, std::span<const SectionSpan>>> holders;
+    std::vector<IniSection> parsed;
+    std::vector<IniSection*> winners;
+    while (!heap.empty())
+    {
+        const NameId section = heap.top().section;
+        holders.clear();
+        while (!heap.empty() && heap.top().section == section)
+        {
+            const size_t source = heap.top().source;
+            heap.pop();
 
-        // UWAGA: Usunięto ToLower(key) -> Klucze są teraz Case-Sensitive (np. RecursiveVariations)
+            const std::vector<SectionSpan>& spans = sources[source].spans;
+            const size_t first = next[source];
+            while (next[source] < spans.size() && spans[next[source]].section == section)
+            {
+                ++next[source];
+            }
+            holders.emplace_back(source, std::span<const SectionSpan>(spans.data() + first, next[source] - first));
 
-        std::string value = trimmedLine.substr(equals + 1);
-        value.erase(0, value.find_first_not_of(" \t\r\n"));
+            if (next[source] < spans.size())
+            {
+                heap.push({ spans[next[source]].section, source });
+            }
+        }
 
-        if (key.empty())
+        // A section of a higher priority replaces the whole section; only
+        // the top bucket is parsed and merged, the others are never read.
+        const int priority = files[holders.back().first].priority;
+        parsed.clear();
+        for (const auto& holder : holders)
         {
-            continue;
+            if (files[holder.first].priority == priority)
+            {
+                parsed.push_back(ReadSection(holder.second));
+            }
         }
 
-        for (const auto& sectionName : currentSections)
+        winners.clear();
+        for (IniSection& copy : parsed)
         {
-            data[sectionName][key] = value;
+            winners.push_back(&copy);
         }
+        target[section] = MergeSection(winners);
     }
-
-    in.close();
-    return data;
 }
 
-void CMvaLoader::MergeIniData(IniData& target, const IniData& source) const
+CMvaLoader::IniSection CMvaLoader::MergeSection(std::span<IniSection* const> sources) const
 {
-    for (const auto& sectionPair : source)
+    // List values are collected per key over all sources and written once
+    // at the end.
+    IniSection merged;
+    std::unordered_map<NameId, CListMerge> lists;
+    for (IniSection* source : sources)
     {
-        auto& section = target[sectionPair.first];
-        for (const auto& kv : sectionPair.second)
+        for (auto& kv : *source)
         {
-            auto& value = section[kv.first];
-            if (kForceReplaceKeys.count(kv.first) > 0)
+            if (forceReplaceKeys.count(kv.first) > 0)
             {
-                value = kv.second;
+                merged[kv.first] = std::move(kv.second);
                 continue;
             }
-            if (!value.empty())
-            {
-                // ZMIANA: Użycie przecinka zamiast spacji przy łączeniu wartości
-                value += ", ";
-            }
-            value += kv.second;
+
+            const ListMergeMode mode = keepDuplicateKeys.count(kv.first) > 0 ? ListMergeMode::KeepDuplicates : ListMergeMode::Unique;
+            lists.try_emplace(kv.first, kCommaList, mode).first->second.Add(kv.second);
         }
     }
-}
 
-void CMvaLoader::ReplaceIniData(IniData& target, const IniData& source) const
-{
-    for (const auto& sectionPair : source)
+    for (const auto& list : lists)
     {
-        // ZMIANA: Zamiast iterować po kluczach i podmieniać pojedyncze wartości,
-        // przypisujemy całą zawartość sekcji z 'source' do 'target'.
-        // Dzięki temu, jeśli w 'target' (niższy priorytet) były klucze, 
-        // których nie ma w 'source' (wyższy priorytet), zostaną one usunięte.
-        // Sekcja staje się identyczna jak w pliku o wyższym priorytecie.
-        target[sectionPair.first] = sectionPair.second;
+        merged[list.first] = list.second.GetValue();
     }
+    return merged;
 }
 
 std::string CMvaLoader::WriteIniData(const IniData& data) const
 {
-    std::ostringstream out;
+    using KeyValue = std::pair<std::string_view, const std::string*>;
+
+    std::string out;
     bool firstSection = true;
 
+    auto writeKeys = [&out](const std::vector<KeyValue>& keys)
+        {
+            for (const auto& kv : keys)
+            {
+                out += kv.first;
+                out += '=';
+                out += *kv.second;
+                out += '\n';
+            }
+        };
+
+    // Names are only looked at here, so this is the one place that sorts.
+    auto byName = [](const KeyValue& a, const KeyValue& b)
+        {
+            return a.first < b.first;
+        };
+
+    NameId settingsId = 0;
+    const bool hasSettings = names.Find("Settings", settingsId) && data.count(settingsId) > 0;
+
     // KROK 1: Zapisz sekcję [Settings] jako pierwszą
-    auto settingsIt = data.find("Settings");
-    if (settingsIt != data.end())
+    if (hasSettings)
     {
-        out << "[Settings]\n";
-        for (const auto& kv : settingsIt->second)
+        std::vector<KeyValue> keys;
+        for (const auto& kv : data.at(settingsId))
         {
-            out << kv.first << "=" << kv.second << "\n";
+            keys.emplace_back(names.GetString(kv.first), &kv.second);
         }
+        std::sort(keys.begin(), keys.end(), byName);
+
+        out += "[Settings]\n";
+        writeKeys(keys);
         firstSection = false;
     }
 
-    // KROK 2: Przetwórz pozostałe sekcje
+    std::vector<std::pair<std::string_view, const IniSection*>> sections;
+    sections.reserve(data.size());
     for (const auto& sectionPair : data)
     {
-        if (sectionPair.first == "Settings")
+        if (!hasSettings || sectionPair.first != settingsId)
         {
-            continue;
+            sections.emplace_back(names.GetString(sectionPair.first), &sectionPair.second);
         }
+    }
+    std::sort(sections.begin(), sections.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
 
+    // KROK 2: Przetwórz pozostałe sekcje
+    std::vector<KeyValue> priorityKeys;
+    std::vector<KeyValue> normalKeys;
+    for (const auto& sectionPair : sections)
+    {
         if (!firstSection)
         {
-            out << "\n";
+            out += '\n';
         }
 
-        out << "[" << sectionPair.first << "]\n";
+        out += '[';
+        out += sectionPair.first;
+        out += "]\n";
 
-        // Kontenery tymczasowe
-        std::vector<std::pair<std::string, std::string>> priorityKeys;
-        std::vector<std::pair<std::string, std::string>> normalKeys;
+        priorityKeys.clear();
+        normalKeys.clear();
 
-        for (const auto& kv : sectionPair.second)
+        for (const auto& kv : *sectionPair.second)
         {
+            const std::string_view key = names.GetString(kv.first);
+
             // WARUNEK PRIORYTETU WIZUALNEGO:
             // 1. Jest na liście kForceReplaceKeys (ważne ustawienia)
             // 2. LUB jest to klucz "Global" (wyjątek na żądanie)
             // 3. LUB zaczyna się od "Wanted" (żeby też były wysoko, jak w Twoim przykładzie)
-            bool isVisualPriority = (kForceReplaceKeys.count(kv.first) > 0)
-                || (kv.first == "Global")
-                || (kv.first.rfind("Wanted", 0) == 0); // rfind(..., 0) == 0 to odpowiednik starts_with
+            const bool isVisualPriority = (forceReplaceKeys.count(kv.first) > 0)
+                || (key == "Global")
+                || key.starts_with("Wanted");
 
             if (isVisualPriority)
             {
-                priorityKeys.push_back(kv);
+                priorityKeys.emplace_back(key, &kv.second);
             }
             else
             {
-                normalKeys.push_back(kv);
+                normalKeys.emplace_back(key, &kv.second);
             }
         }
 
         // Sortowanie kluczy PRIORYTETOWYCH
         // Tutaj ustalamy sztywną kolejność: Global zawsze pierwszy
-        auto prioritySort = [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b)
+        auto prioritySort = [](const KeyValue& a, const KeyValue& b)
             {
                 // Jeśli jeden z kluczy to Global, ma on pierwszeństwo absolutne
                 if (a.first == "Global") return true;
@@ -712,29 +748,15 @@ std::string CMvaLoader::WriteIniData(const IniData& data) const
                 return a.first < b.first;
             };
 
-        // Sortowanie zwykłych kluczy alfabetycznie
-        auto normalSort = [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b)
-            {
-                return a.first < b.first;
-            };
-
         std::sort(priorityKeys.begin(), priorityKeys.end(), prioritySort);
-        std::sort(normalKeys.begin(), normalKeys.end(), normalSort);
-
-        // Zapisz priorytetowe
-        for (const auto& kv : priorityKeys)
-        {
-            out << kv.first << "=" << kv.second << "\n";
-        }
+        std::sort(normalKeys.begin(), normalKeys.end(), byName);
 
-        // Zapisz resztę
-        for (const auto& kv : normalKeys)
-        {
-            out << kv.first << "=" << kv.second << "\n";
-        }
+        // Zapisz priorytetowe, potem resztę
+        writeKeys(priorityKeys);
+        writeKeys(normalKeys);
 
         firstSection = false;
     }
 
-    return out.str();
+    return out;
 }
@@ -1,8 +1,13 @@
 #pragma once
+#include "line_reader.h"
+#include "string_interner.h"
+#include <cstdint>
 #include <filesystem>
+#include <span>
 #include <string>
-#include <map>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 struct MvaFileEntry
@@ -18,19 +23,50 @@ public:
     void Process();
 
 private:
-    using IniSection = std::map<std::string, std::string>;
-    using IniData = std::map<std::string, IniSection>;
-
-    void CollectMvaFiles(const std::filesystem::path& modloaderRoot, std::vector<MvaFileEntry>& entries) const;
-    std::unordered_map<std::string, int> LoadPriorities(const std::filesystem::path& modloaderIni) const;
-    std::filesystem::path FindOriginalIni(
-        const std::filesystem::path& modloaderRoot,
-        const std::string& filename,
-        std::unordered_map<std::string, std::filesystem::path>& cache) const;
-    IniData ReadIniData(const std::filesystem::path& path) const;
-    void MergeIniData(IniData& target, const IniData& source) const;
-    void ReplaceIniData(IniData& target, const IniData& source) const;
+    // Section and key names are interned ids; they are only put in name
+    // order by WriteIniData().
+    using NameId = CStringInterner::Id;
+    using IniSection = std::unordered_map<NameId, std::string>;
+    using IniData = std::unordered_map<NameId, IniSection>;
+
+    // The lines from the first to the last key of one section under one
+    // header, pointing into the mapped source.
+    struct SectionSpan
+    {
+        NameId section;
+        std::string_view body;
+    };
+
+    // A .mva file mapped into memory with its section bodies sorted by
+    // section id, in file order within a section. Nothing is parsed until
+    // the merge asks for a section.
+    struct SourceIndex
+    {
+        CMappedFile file;
+        std::vector<SectionSpan> spans;
+    };
+
+    void CollectMvaFiles(std::vector<MvaFileEntry>& entries) const;
+    std::filesystem::path FindOriginalIni(const std::string& filename) const;
+    // ReadIniData, IndexSections and ReadSection are called from several
+    // pool threads at once; they only touch the interner.
+    IniData ReadIniData(const std::filesystem::path& path);
+    void IndexSections(const std::filesystem::path& path, SourceIndex& source);
+    IniSection ReadSection(std::span<const SectionSpan> spans);
+    void ReadSectionNames(std::string_view header, std::vector<NameId>& sections);
+    // Sources are sorted by priority. Each section comes from the highest
+    // priority that has it, merged over all sources of that priority, and
+    // replaces the section in target. Only those copies are ever parsed.
+    void MergeSources(IniData& target, const std::vector<MvaFileEntry>& files, std::span<const SourceIndex> sources);
+    // List values are merged element by element, force-replace keys take
+    // the last value.
+    IniSection MergeSection(std::span<IniSection* const> sources) const;
     std::string WriteIniData(const IniData& data) const;
+
+    // Kept for the whole run; the same names come back with every .mva.
+    CStringInterner names;
+    std::unordered_set<NameId> forceReplaceKeys;
+    std::unordered_set<NameId> keepDuplicateKeys;
 };
 
 extern CMvaLoader MvaLoader;
@@ -1,4 +1,5 @@
 #pragma once
+#include "record_schema.h"
 #include <vector>
 
 class CFLARadarBlipSpriteFilenamesLoader
@@ -8,8 +9,12 @@ private:
     void UpdateRadarBlipSpriteFilenamesFile();
 
 public:
+    // index, name, texture
+    using Record = CRecordSchema<RecordField::Int, RecordField::Token, RecordField::Token>;
+
     void AddLine(const std::string &line);
-    void Parse(const std::string &line);
+    // Takes the line when it is a record of this table.
+    bool Parse(const CRecordLine &line);
     void Process();
 };
 
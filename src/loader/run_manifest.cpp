@@ -0,0 +1,329 @@
+#include "pch.h"
+#include "run_manifest.h"
+#include "dir_reader.h"
+#include "logger.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+CRunManifest RunManifest;
+
+namespace
+{
+    const char* kLogPrefix = "MANIFEST";
+    const char* kManifestHeader = "comp.injector run manifest 3";
+
+    std::string ToUtf8(const std::filesystem::path& path)
+    {
+        const std::u8string value = path.u8string();
+        return std::string(value.begin(), value.end());
+    }
+
+    std::filesystem::path FromUtf8(const std::string& value)
+    {
+        return std::filesystem::path(std::u8string(value.begin(), value.end()));
+    }
+}
+
+void CFingerprint::Add(std::string_view value)
+{
+    for (char ch : value)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ull;
+    }
+
+    // Separator, so "ab" + "c" and "a" + "bc" differ.
+    hash ^= 0xFF;
+    hash *= 1099511628211ull;
+}
+
+void CFingerprint::Add(int64_t value)
+{
+    Add(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)));
+}
+
+void CFingerprint::AddFile(const std::filesystem::path& path)
+{
+    uintmax_t size = 0;
+    int64_t modified = 0;
+    const std::error_code ec = CDirReader::GetFileInfo(path, size, modified);
+
+    Add(ToUtf8(path));
+    Add(ec ? int64_t(-1) : static_cast<int64_t>(size));
+    Add(ec ? int64_t(-1) : modified);
+}
+
+void CFingerprint::AddFolder(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    const int64_t modified = CDirReader::GetModifiedTime(path, ec);
+
+    Add(ToUtf8(path));
+    Add(ec ? int64_t(-1) : modified);
+}
+
+uint64_t CFingerprint::Get() const
+{
+    return hash;
+}
+
+bool CRunManifest::Load(const std::filesystem::path& manifestPath)
+{
+    loaded = false;
+    previousFingerprints.clear();
+    previousOutputs.clear();
+    previousPluginInjFiles.clear();
+    previousInputFolders.clear();
+
+    std::ifstream in(manifestPath, std::ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    if (!getline(in, line) || line != kManifestHeader)
+    {
+        return false;
+    }
+
+    // F <fingerprint of the next stage>
+    // O <size> <modified> <output path>
+    // J <.inj path outside modloader>
+    // P <folder searched for .inj files outside modloader>
+    while (getline(in, line))
+    {
+        if (line.size() < 2 || line[1] != ' ')
+        {
+            return false;
+        }
+
+        std::istringstream stream(line.substr(2));
+        if (line[0] == 'F')
+        {
+            uint64_t fingerprint = 0;
+            stream >> std::hex >> fingerprint;
+            previousFingerprints.push_back(fingerprint);
+        }
+        else if (line[0] == 'O')
+        {
+            Output output;
+            stream >> output.size >> output.modified;
+            stream.get();
+            std::string path;
+            getline(stream, path);
+            output.path = FromUtf8(path);
+            previousOutputs.push_back(std::move(output));
+        }
+        else if (line[0] == 'J')
+        {
+            previousPluginInjFiles.push_back(FromUtf8(line.substr(2)));
+        }
+        else if (line[0] == 'P')
+        {
+            previousInputFolders.push_back(FromUtf8(line.substr(2)));
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    loaded = true;
+    return true;
+}
+
+unsigned CRunManifest::GetStaleStages(const std::vector<uint64_t>& fingerprints) const
+{
+    if (!loaded || fingerprints.size() != previousFingerprints.size())
+    {
+        return (1u << fingerprints.size()) - 1;
+    }
+
+    unsigned stale = 0;
+    for (size_t i = 0; i < fingerprints.size(); ++i)
+    {
+        if (fingerprints[i] != previousFingerprints[i])
+        {
+            stale |= 1u << i;
+        }
+    }
+    return stale;
+}
+
+bool CRunManifest::AreOutputsCurrent() const
+{
+    if (!loaded)
+    {
+        return false;
+    }
+
+    for (const auto& output : previousOutputs)
+    {
+        uintmax_t size = 0;
+        int64_t modified = 0;
+        if (CDirReader::GetFileInfo(output.path, size, modified) || size != output.size || modified != output.modified)
+        {
+            Logger.Log(std::string(kLogPrefix) + ": output changed since the last run: " + output.path.string());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const std::vector<std::filesystem::path>& CRunManifest::GetPluginInjFiles() const
+{
+    return previousPluginInjFiles;
+}
+
+const std::vector<std::filesystem::path>& CRunManifest::GetInputFolders() const
+{
+    return previousInputFolders;
+}
+
+void CRunManifest::Reset()
+{
+    loaded = false;
+}
+
+void CRunManifest::BeginRun()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& output : outputs)
+    {
+        const auto previous = std::find_if(previousOutputs.begin(), previousOutputs.end(), [&output](const Output& known)
+            {
+                return known.path == output.path;
+            });
+
+        if (previous != previousOutputs.end())
+        {
+            *previous = std::move(output);
+        }
+        else
+        {
+            previousOutputs.push_back(std::move(output));
+        }
+    }
+    outputs.clear();
+}
+
+bool CRunManifest::IsOutput(const std::filesystem::path& path)
+{
+    // Outputs of earlier runs count as well, a partial refresh does not
+    // rewrite them all.
+    const auto matches = [&path](const Output& output)
+        {
+            return output.path == path;
+        };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::any_of(outputs.begin(), outputs.end(), matches) || std::any_of(previousOutputs.begin(), previousOutputs.end(), matches);
+}
+
+std::vector<std::filesystem::path> CRunManifest::GetOutputs()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(outputs.size());
+    for (const auto& output : outputs)
+    {
+        paths.push_back(output.path);
+    }
+    return paths;
+}
+
+void CRunManifest::RecordOutput(const std::filesystem::path& path)
+{
+    Output output;
+    output.path = path;
+    output.exists = !CDirReader::GetFileInfo(path, output.size, output.modified);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    outputs.push_back(std::move(output));
+}
+
+void CRunManifest::Save(const std::filesystem::path& manifestPath, const std::vector<uint64_t>& fingerprints,
+    const std::vector<std::filesystem::path>& pluginInjFiles, const std::vector<std::filesystem::path>& inputFolders, bool fullRun)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // The last write of a file is the one it has to match; this run's
+    // records come after the earlier ones.
+    std::vector<Output> all;
+    if (!fullRun)
+    {
+        all = previousOutputs;
+    }
+    all.insert(all.end(), outputs.begin(), outputs.end());
+    std::stable_sort(all.begin(), all.end(), [](const Output& left, const Output& right)
+        {
+            return left.path < right.path;
+        });
+    std::vector<Output> written;
+    for (auto& output : all)
+    {
+        if (!written.empty() && written.back().path == output.path)
+        {
+            written.back() = std::move(output);
+        }
+        else
+        {
+            written.push_back(std::move(output));
+        }
+    }
+    std::erase_if(written, [](const Output& output)
+        {
+            return !output.exists;
+        });
+
+    std::filesystem::path tempPath = manifestPath;
+    tempPath += ".tmp";
+
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        Logger.Log(std::string(kLogPrefix) + ": failed to write " + tempPath.string());
+        return;
+    }
+
+    out << kManifestHeader << "\n";
+    for (const uint64_t fingerprint : fingerprints)
+    {
+        out << "F " << std::hex << fingerprint << std::dec << "\n";
+    }
+    for (const auto& output : written)
+    {
+        out << "O " << output.size << " " << output.modified << " " << ToUtf8(output.path) << "\n";
+    }
+    for (const auto& path : pluginInjFiles)
+    {
+        out << "J " << ToUtf8(path) << "\n";
+    }
+    for (const auto& path : inputFolders)
+    {
+        out << "P " << ToUtf8(path) << "\n";
+    }
+    out.close();
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, manifestPath, ec);
+    if (ec)
+    {
+        Logger.Log(std::string(kLogPrefix) + ": failed to save " + manifestPath.string() + ": " + ec.message());
+        return;
+    }
+
+    // What was saved is what the next run compares against, in this process
+    // as well.
+    loaded = true;
+    previousFingerprints = fingerprints;
+    previousOutputs = std::move(written);
+    previousPluginInjFiles = pluginInjFiles;
+    previousInputFolders = inputFolders;
+    outputs.clear();
+
+    Logger.Log(std::string(kLogPrefix) + ": saved " + std::to_string(previousOutputs.size()) + " outputs.");
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// 64-bit FNV-1a over everything a run depends on.
+class CFingerprint
+{
+public:
+    void Add(std::string_view value);
+    void Add(int64_t value);
+    void AddFile(const std::filesystem::path& path);    // path, size and write time
+    void AddFolder(const std::filesystem::path& path);  // path and write time
+    uint64_t Get() const;
+
+private:
+    uint64_t hash = 14695981039346656037ull;
+};
+
+// Remembers one input fingerprint per pipeline stage together with the size
+// and write time every output had right after it was written. A stage whose
+// fingerprint still matches has nothing to redo; when all match and no output
+// changed, the next launch can skip all loaders without reading or writing
+// any game file. An output edited by hand no longer matches what was written,
+// so the next launch repairs it.
+class CRunManifest
+{
+public:
+    bool Load(const std::filesystem::path& manifestPath);
+    // Bit i is set when fingerprints[i] differs from the saved one; every
+    // bit is set when nothing was loaded or saved yet.
+    unsigned GetStaleStages(const std::vector<uint64_t>& fingerprints) const;
+    // False when nothing was loaded or an output changed since it was written.
+    bool AreOutputsCurrent() const;
+    const std::vector<std::filesystem::path>& GetPluginInjFiles() const;
+    const std::vector<std::filesystem::path>& GetInputFolders() const;
+
+    // After a failed run, whose outputs may be half written: every stage
+    // counts as stale until the next save.
+    void Reset();
+    // Call before every run. What earlier runs wrote still counts for
+    // IsOutput(); GetOutputs() starts empty again.
+    void BeginRun();
+    // Call right after writing path. Safe to call from pool tasks.
+    void RecordOutput(const std::filesystem::path& path);
+    bool IsOutput(const std::filesystem::path& path);
+    // The files written since BeginRun().
+    std::vector<std::filesystem::path> GetOutputs();
+
+    // fingerprints has to describe every stage's outputs as they are on disk:
+    // after a partial run no stage that was left out may be stale. A full run
+    // lists only its own outputs, a partial one keeps those of earlier runs.
+    void Save(const std::filesystem::path& manifestPath, const std::vector<uint64_t>& fingerprints,
+        const std::vector<std::filesystem::path>& pluginInjFiles, const std::vector<std::filesystem::path>& inputFolders, bool fullRun);
+
+private:
+    struct Output
+    {
+        std::filesystem::path path;
+        uintmax_t size = 0;
+        int64_t modified = 0;
+        bool exists = true;
+    };
+
+    bool loaded = false;
+    std::vector<uint64_t> previousFingerprints;
+    std::vector<Output> previousOutputs;
+    std::vector<std::filesystem::path> previousPluginInjFiles;
+    std::vector<std::filesystem::path> previousInputFolders;
+
+    std::mutex mutex;
+    std::vector<Output> outputs;
+};
+
+extern CRunManifest RunManifest;
@@ -1,4 +1,5 @@
 #pragma once
+#include "record_schema.h"
 #include <vector>
 
 class CFLATrainTypeCarriagesLoader
@@ -8,8 +9,12 @@ private:
     void UpdateTrainTypeCarriagesFile();
 
 public:
+    // trainType, then one to twelve carriage models
+    using Record = CRecordSchema<RecordField::Int, RecordField::Tokens<1, 12>>;
+
     void AddLine(const std::string &line);
-    void Parse(const std::string &line);
+    // Takes the line when it is a record of this table.
+    bool Parse(const CRecordLine &line);
     void Process();
 };
 
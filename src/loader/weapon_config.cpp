@@ -1,34 +1,18 @@
 #include "pch.h"
 #include "weapon_config.h"
 #include "logger.h"
-#include <algorithm>
-#include <cctype>
-#include <cstring>
-#include <unordered_set>
+#include "run_manifest.h"
+#include "line_reader.h"
+#include "text_utils.h"
+#include "record_merge.h"
 
 CFLAWeaponConfigLoader FLAWeaponConfigLoader;
 
 namespace {
 const char* kLogPrefix = "WEAPON_CONFIG";
-std::string ToLowerCopy(std::string value) {
-    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) {
-        return static_cast<char>(std::tolower(ch));
-    });
-    return value;
-}
-
-std::string TrimCopy(const std::string &value) {
-    const auto start = value.find_first_not_of(" \t\r\n");
-    if (start == std::string::npos) {
-        return "";
-    }
-    const auto end = value.find_last_not_of(" \t\r\n");
-    return value.substr(start, end - start + 1);
-}
-
-bool IsEndMarker(const std::string &line) {
-    std::string lowered = ToLowerCopy(TrimCopy(line));
-    return lowered == "end" || lowered == "the end" || lowered == ";the end";
+bool IsEndMarker(std::string_view line) {
+    line = Text::Trim(line);
+    return Text::EqualsIgnoreCase(line, "end") || Text::EqualsIgnoreCase(line, "the end") || Text::EqualsIgnoreCase(line, ";the end");
 }
 
 std::filesystem::path GetBasePathFromInjector(const std::filesystem::path &settingsPath) {
@@ -38,19 +22,8 @@ std::filesystem::path GetBasePathFromInjector(const std::filesystem::path &setti
 const char* kMarker = "; comp.injector added weapons";
 
 bool HasMarker(const std::string &settingsPath) {
-    std::ifstream in(settingsPath);
-    if (!in.is_open()) {
-        return false;
-    }
-
-    std::string line;
-    while (getline(in, line)) {
-        if (line.find(kMarker) != std::string::npos) {
-            return true;
-        }
-    }
-
-    return false;
+    CMappedFile in;
+    return !in.Open(settingsPath) && in.GetData().find(kMarker) != std::string_view::npos;
 }
 }
 
@@ -60,18 +33,6 @@ void CFLAWeaponConfigLoader::UpdateWeaponConfigFile()
     std::filesystem::path settingsPathTemp = settingsPath;
     settingsPathTemp += ".tmp";
     std::filesystem::path basePath = GetBasePathFromInjector(settingsPath);
-    auto isCommentOrEmpty = [](const std::string &value)
-        {
-            const auto start = value.find_first_not_of(" \t\r\n");
-            if (start == std::string::npos)
-            {
-                return true;
-            }
-
-            const std::string_view trimmed(value.c_str() + start, value.size() - start);
-
-            return trimmed.starts_with(";") || trimmed.starts_with("#") || trimmed.starts_with("//");
-        };
 
     if (!std::filesystem::exists(basePath))
     {
@@ -81,36 +42,45 @@ void CFLAWeaponConfigLoader::UpdateWeaponConfigFile()
 
     if (store.empty())
     {
-        std::ifstream in(basePath, std::ios::binary);
+        CMappedFile in;
+        in.Open(basePath);
         std::ofstream out(settingsPathTemp, std::ios::binary | std::ios::trunc);
-        if (!in.is_open() || !out.is_open())
+        if (!in.IsOpen() || !out.is_open())
         {
             return;
         }
 
-        out << in.rdbuf();
-        in.close();
+        const std::string_view base = in.GetData();
+        out.write(base.data(), static_cast<std::streamsize>(base.size()));
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": refreshed " + settingsPath.string());
         return;
     }
 
-    std::unordered_set<std::string> writtenLines;
-    std::unordered_set<std::string> existingLines;
+    // Keyed by weapon id.
+    CRecordMerge rows(RecordKeyKind::Int, &Record::Key);
+    for (const auto& e : store)
+    {
+        rows.Add(e);
+    }
 
-    std::ifstream in(basePath);
+    CMappedFile in;
+    in.Open(basePath);
     std::ofstream out(settingsPathTemp);
 
-    if (in.is_open() && out.is_open())
+    if (in.IsOpen() && out.is_open())
     {
-        std::string line;
+        CLineReader reader(in.GetData());
+        std::string_view line;
         bool ignoreLines = false;
         bool foundEndMarker = false;
         std::string endMarker;
-        while (getline(in, line))
+        while (reader.Next(line))
         {
             if (line.find(kMarker) != std::string::npos)
             {
@@ -130,29 +100,24 @@ void CFLAWeaponConfigLoader::UpdateWeaponConfigFile()
                 continue;
             }
 
-            if (isCommentOrEmpty(line))
+            if (Text::IsCommentOrEmpty(line))
             {
                 out << line << "\n";
                 continue;
             }
 
-            out << line << "\n";
-            existingLines.insert(line);
+            std::string_view row;
+            if (rows.TakeBaseRow(line, row))
+            {
+                out << row << "\n";
+            }
         }
 
         out << kMarker << "\n";
 
-        for (auto &e : store)
+        for (const std::string_view row : rows.GetAddedRows())
         {
-            if (existingLines.count(e) > 0)
-            {
-                continue;
-            }
-
-            if (writtenLines.insert(e).second)
-            {
-                out << e << "\n";
-            }
+            out << row << "\n";
         }
 
         if (foundEndMarker)
@@ -164,16 +129,17 @@ void CFLAWeaponConfigLoader::UpdateWeaponConfigFile()
             out << ";the end\n";
         }
 
-        in.close();
+        in.Close();
         out.close();
 
         std::filesystem::remove(settingsPath);
         std::filesystem::rename(settingsPathTemp, settingsPath);
+        RunManifest.RecordOutput(settingsPath);
         Logger.Log(std::string(kLogPrefix) + ": updated " + settingsPath.string());
     }
     else
     {
-        if (in.is_open()) in.close();
+        if (in.IsOpen()) in.Close();
         if (out.is_open()) out.close();
     }
 }
@@ -188,6 +154,8 @@ void CFLAWeaponConfigLoader::Process()
 
     Logger.Log(std::string(kLogPrefix) + ": processing weapon config.");
     UpdateWeaponConfigFile();
+
+    store.clear();
 }
 
 void CFLAWeaponConfigLoader::AddLine(const std::string &line)
@@ -195,33 +163,13 @@ void CFLAWeaponConfigLoader::AddLine(const std::string &line)
     store.push_back(line);
 }
 
-void CFLAWeaponConfigLoader::Parse(const std::string &line)
+bool CFLAWeaponConfigLoader::Parse(const CRecordLine &line)
 {
-    int index = 0;
-    char name[256] = {};
-    int ammoClip = 0;
-    int damage = 0;
-    int accuracy = 0;
-    int flags = 0;
-    int animGroup = 0;
-    int modelId1 = 0;
-    int modelId2 = 0;
-    float range = 0.0f;
-
-    int count = sscanf(line.c_str(), "%d %255s %d %d %d %d %d %d %d %f",
-        &index,
-        name,
-        &ammoClip,
-        &damage,
-        &accuracy,
-        &flags,
-        &animGroup,
-        &modelId1,
-        &modelId2,
-        &range);
-
-    if (count == 10 && strnlen(name, sizeof(name)) > 0)
+    if (!Record::Matches(line))
     {
-        store.push_back(line);
+        return false;
     }
+
+    store.emplace_back(line.GetText());
+    return true;
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "record_schema.h"
 #include <vector>
 
 class CFLAWeaponConfigLoader
@@ -8,8 +9,15 @@ private:
     void UpdateWeaponConfigFile();
 
 public:
+    // index, name, ammoClip, damage, accuracy, flags, animGroup, modelId1,
+    // modelId2, range
+    using Record = CRecordSchema<RecordField::Int, RecordField::Token,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Int,
+        RecordField::Int, RecordField::Int, RecordField::Int, RecordField::Float>;
+
     void AddLine(const std::string &line);
-    void Parse(const std::string &line);
+    // Takes the line when it is a record of this table.
+    bool Parse(const CRecordLine &line);
     void Process();
 };
 
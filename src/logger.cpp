@@ -30,6 +30,8 @@ void CLogger::Log(const std::string& message)
         return;
     }
 
+    // Loaders may log from task pool workers.
+    std::lock_guard<std::mutex> lock(mutex);
     std::ofstream out(path, std::ios::app);
     if (!out.is_open())
     {
@@ -1,5 +1,6 @@
 #pragma once
 #include <filesystem>
+#include <mutex>
 #include <string>
 
 class CLogger
@@ -11,6 +12,7 @@ public:
 
 private:
     std::filesystem::path path;
+    std::mutex mutex;
 };
 
 extern CLogger Logger;
@@ -1,9 +1,21 @@
 ﻿#define WIN32_LEAN_AND_MEAN
 
-#include <plugin.h>
 #include <string>
 #include <filesystem>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include "platform_posix.h"
+#endif
+#ifdef COMP_INJECTOR_CLI
+// The command line host has no game process to ask, it gets both folders
+// from its arguments.
+extern std::filesystem::path gGameRoot;
+extern std::filesystem::path gPluginDir;
+#define GAME_PATH(x) ((gGameRoot / (x)).string())
+#else
+#include <plugin.h>
+#endif
 #include "ini.hpp"
 #include <sstream>  // Do obsługi std::stringstream
 #include <cctype>   // Do obsługi std::isalpha
@@ -17,6 +29,9 @@ extern CIniReader gConfig;
 
 inline std::filesystem::path GetInjectorBasePath(const std::filesystem::path& originalPath)
 {
+#ifdef COMP_INJECTOR_CLI
+    return gPluginDir / "reference" / originalPath.filename();
+#else
     char modulePath[MAX_PATH] = {};
     HMODULE moduleHandle = GetModuleHandleA(MODNAME_EXT);
     if (moduleHandle == nullptr)
@@ -37,4 +52,5 @@ inline std::filesystem::path GetInjectorBasePath(const std::filesystem::path& or
     }
 
     return gameRoot / "reference" / originalPath.filename();
+#endif
 }
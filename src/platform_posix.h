@@ -0,0 +1,66 @@
+#pragma once
+// Stand-ins for the few Win32/CRT calls used by the shared code, so the
+// command line host also builds on Linux. Never included by the plugin.
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+#include <unistd.h>
+
+#define MAX_PATH 4096
+#define GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS 0x4
+#define GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT 0x2
+#define _snprintf_s(buffer, count, ...) std::snprintf(buffer, count, __VA_ARGS__)
+
+typedef int BOOL;
+typedef int errno_t;
+typedef unsigned long DWORD;
+typedef const char* LPCSTR;
+typedef void* HMODULE;
+
+inline HMODULE GetModuleHandleA(LPCSTR)
+{
+    return nullptr;
+}
+
+inline BOOL GetModuleHandleExA(DWORD, LPCSTR, HMODULE* module)
+{
+    *module = nullptr;
+    return 1;
+}
+
+// Only the running executable can be resolved.
+inline DWORD GetModuleFileNameA(HMODULE, char* buffer, DWORD size)
+{
+    const ssize_t length = readlink("/proc/self/exe", buffer, size - 1);
+    buffer[length > 0 ? length : 0] = '\0';
+    return length > 0 ? static_cast<DWORD>(length) : 0;
+}
+
+// CIniReader::Write* are not used by the loaders.
+inline BOOL WritePrivateProfileStringA(LPCSTR, LPCSTR, LPCSTR, LPCSTR)
+{
+    return 0;
+}
+
+inline int _stricmp(const char* left, const char* right)
+{
+    return strcasecmp(left, right);
+}
+
+inline int _strnicmp(const char* left, const char* right, size_t count)
+{
+    return strncasecmp(left, right, count);
+}
+
+inline errno_t fopen_s(FILE** file, const char* name, const char* mode)
+{
+    *file = std::fopen(name, mode);
+    return *file != nullptr ? 0 : errno;
+}
+
+inline errno_t localtime_s(std::tm* result, const std::time_t* time)
+{
+    return localtime_r(time, result) != nullptr ? 0 : errno;
+}
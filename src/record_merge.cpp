@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "record_merge.h"
+#include "record_schema.h"
+#include "text_utils.h"
+
+namespace
+{
+    constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+    constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+    uint64_t HashText(std::string_view text, bool foldCase)
+    {
+        uint64_t hash = kFnvOffset;
+        for (char ch : text)
+        {
+            if (foldCase && ch >= 'A' && ch <= 'Z')
+            {
+                ch = static_cast<char>(ch + ('a' - 'A'));
+            }
+            hash = (hash ^ static_cast<unsigned char>(ch)) * kFnvPrime;
+        }
+        return hash;
+    }
+
+    uint64_t HashInt(int value)
+    {
+        // splitmix64 finalizer.
+        uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(value)) + 0x9E3779B97F4A7C15ull;
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+        return hash ^ (hash >> 31);
+    }
+}
+
+CRecordMerge::CRecordMerge(RecordKeyKind kind, KeyToken keyToken)
+    : kind(kind), keyToken(keyToken)
+{
+}
+
+void CRecordMerge::Add(std::string_view row)
+{
+    const RowKey key = KeyOf(row);
+    uint64_t hash = 0;
+    const size_t slot = Find(key, hash);
+    if (slot != npos)
+    {
+        slots[slot].row = row;
+        return;
+    }
+
+    index.emplace(hash, slots.size());
+    slots.push_back({ key, row, true, false });
+}
+
+bool CRecordMerge::TakeBaseRow(std::string_view line, std::string_view& row)
+{
+    const RowKey key = KeyOf(line);
+    uint64_t hash = 0;
+    const size_t slot = Find(key, hash);
+    if (slot == npos)
+    {
+        index.emplace(hash, slots.size());
+        slots.push_back({ key, line, false, true });
+        row = line;
+        return true;
+    }
+
+    if (slots[slot].written)
+    {
+        return false;
+    }
+
+    slots[slot].written = true;
+    row = slots[slot].row;
+    return true;
+}
+
+std::vector<std::string_view> CRecordMerge::GetAddedRows() const
+{
+    std::vector<std::string_view> rows;
+    for (const auto& slot : slots)
+    {
+        if (slot.fromMod && !slot.written)
+        {
+            rows.push_back(slot.row);
+        }
+    }
+    return rows;
+}
+
+CRecordMerge::RowKey CRecordMerge::KeyOf(std::string_view row) const
+{
+    RowKey key;
+    const std::string_view token = keyToken(row);
+    if (kind == RecordKeyKind::Int && RecordText::ParseInt(token, key.value))
+    {
+        key.hash = HashInt(key.value);
+    }
+    else if (kind == RecordKeyKind::Name && !token.empty())
+    {
+        key.text = token;
+        key.hash = HashText(token, true);
+    }
+    else
+    {
+        key.isText = true;
+        key.text = row;
+        key.hash = HashText(row, false);
+    }
+    return key;
+}
+
+bool CRecordMerge::SameKey(const RowKey& left, const RowKey& right) const
+{
+    if (left.isText != right.isText)
+    {
+        return false;
+    }
+    if (left.isText)
+    {
+        return left.text == right.text;
+    }
+    return kind == RecordKeyKind::Int ? left.value == right.value : Text::EqualsIgnoreCase(left.text, right.text);
+}
+
+size_t CRecordMerge::Find(const RowKey& key, uint64_t& hash) const
+{
+    // Keys whose hashes collide take the next free hash.
+    for (hash = key.hash;; ++hash)
+    {
+        auto it = index.find(hash);
+        if (it == index.end())
+        {
+            return npos;
+        }
+        if (SameKey(slots[it->second].key, key))
+        {
+            return it->second;
+        }
+    }
+}
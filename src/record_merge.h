@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// How the key token of a data table row compares.
+enum class RecordKeyKind
+{
+    // Weapon, melee, cheat and radar ids, train types: "+7" and "7" match.
+    Int,
+    // Vehicle, model and track names, which the game compares without case.
+    Name
+};
+
+// Puts the rows mods add to a data table over the rows of its base file,
+// one row per record key. Keys are indexed by a 64-bit hash. Among the mod
+// rows the last one of a key wins; it replaces the base row of that key in
+// place, and keys the base does not have are added in the order they first
+// appeared. A key repeated in the base keeps its first row. Rows without a
+// key are only merged when their text is identical. The rows' text has to
+// outlive the merge.
+class CRecordMerge
+{
+public:
+    using KeyToken = std::string_view (*)(std::string_view row);
+
+    CRecordMerge(RecordKeyKind kind, KeyToken keyToken);
+
+    // Mod rows, in load order.
+    void Add(std::string_view row);
+    // For each record row of the base, in file order: false when the row's
+    // key was already written, otherwise row is what to write in its place.
+    bool TakeBaseRow(std::string_view line, std::string_view& row);
+    // The mod rows the base had no key for.
+    std::vector<std::string_view> GetAddedRows() const;
+
+private:
+    struct RowKey
+    {
+        uint64_t hash = 0;
+        bool isText = false;
+        int value = 0;
+        std::string_view text;
+    };
+
+    struct Slot
+    {
+        RowKey key;
+        std::string_view row;
+        bool fromMod = false;
+        bool written = false;
+    };
+
+    RowKey KeyOf(std::string_view row) const;
+    bool SameKey(const RowKey& left, const RowKey& right) const;
+    // The slot of key, or npos with hash set to the free place for it.
+    size_t Find(const RowKey& key, uint64_t& hash) const;
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    RecordKeyKind kind;
+    KeyToken keyToken;
+    std::vector<Slot> slots;
+    std::unordered_map<uint64_t, size_t> index;
+};
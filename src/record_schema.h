@@ -0,0 +1,261 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+// Whitespace separated tokens of a data file line, read the way sscanf and
+// operator>> split them but without locale, stream or copies.
+namespace RecordText
+{
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    // Token starting at or after offset, empty once the line is exhausted.
+    inline std::string_view NextToken(std::string_view line, size_t& offset)
+    {
+        while (offset < line.size() && IsSpace(line[offset]))
+        {
+            ++offset;
+        }
+
+        const size_t start = offset;
+        while (offset < line.size() && !IsSpace(line[offset]))
+        {
+            ++offset;
+        }
+        return line.substr(start, offset - start);
+    }
+
+    // The whole token has to be a number; a leading '+' is accepted like %d.
+    inline bool ParseInt(std::string_view token, int& value)
+    {
+        if (token.size() > 1 && token[0] == '+' && token[1] != '-')
+        {
+            token.remove_prefix(1);
+        }
+        const auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        return result.ec == std::errc() && result.ptr == token.data() + token.size();
+    }
+
+    inline bool ParseFloat(std::string_view token, float& value)
+    {
+        if (token.size() > 1 && token[0] == '+' && token[1] != '-')
+        {
+            token.remove_prefix(1);
+        }
+        const auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        return result.ec == std::errc() && result.ptr == token.data() + token.size();
+    }
+}
+
+constexpr size_t kMaxRecordTokens = 16;
+
+// How a line looks once split: its token count (kMaxRecordTokens + 1 when
+// there are more) and which of the first kMaxRecordTokens tokens read as
+// numbers. Every int also reads as a float.
+struct RecordShape
+{
+    size_t count = 0;
+    uint32_t intMask = 0;
+    uint32_t floatMask = 0;
+};
+
+// The shapes a schema accepts, checked with a few compares per line.
+struct RecordShapeRule
+{
+    size_t minCount;
+    size_t maxCount;
+    uint32_t intMask;
+    uint32_t floatMask;
+
+    constexpr bool Matches(const RecordShape& shape) const
+    {
+        return shape.count >= minCount && shape.count <= maxCount &&
+            (shape.intMask & intMask) == intMask && (shape.floatMask & floatMask) == floatMask;
+    }
+};
+
+// Any line with at least one token.
+constexpr RecordShapeRule kAnyRecordShape = { 1, kMaxRecordTokens + 1, 0, 0 };
+
+// A line tokenized and classified once, so any number of schemas can test
+// it without splitting it again.
+class CRecordLine
+{
+public:
+    explicit CRecordLine(std::string_view text) : text(text)
+    {
+        size_t offset = 0;
+        for (std::string_view token = RecordText::NextToken(text, offset); !token.empty(); token = RecordText::NextToken(text, offset))
+        {
+            if (shape.count == kMaxRecordTokens)
+            {
+                ++shape.count;
+                break;
+            }
+
+            int intValue = 0;
+            float floatValue = 0.0f;
+            const uint32_t bit = 1u << shape.count;
+            if (RecordText::ParseInt(token, intValue))
+            {
+                shape.intMask |= bit;
+                shape.floatMask |= bit;
+            }
+            else if (RecordText::ParseFloat(token, floatValue))
+            {
+                shape.floatMask |= bit;
+            }
+            tokens[shape.count++] = token;
+        }
+    }
+
+    std::string_view GetText() const { return text; }
+    const RecordShape& GetShape() const { return shape; }
+    // Only the first kMaxRecordTokens tokens are kept.
+    std::string_view GetToken(size_t index) const { return tokens[index]; }
+
+private:
+    std::string_view text;
+    std::array<std::string_view, kMaxRecordTokens> tokens;
+    RecordShape shape;
+};
+
+// Field kinds of a CRecordSchema.
+namespace RecordField
+{
+    struct Int
+    {
+        static constexpr bool kInt = true;
+        static constexpr bool kFloat = true;
+        static constexpr bool kEndsLine = false;
+    };
+
+    struct Float
+    {
+        static constexpr bool kInt = false;
+        static constexpr bool kFloat = true;
+        static constexpr bool kEndsLine = false;
+    };
+
+    struct Token
+    {
+        static constexpr bool kInt = false;
+        static constexpr bool kFloat = false;
+        static constexpr bool kEndsLine = false;
+    };
+
+    // Between Min and Max tokens up to the end of the line. Only valid as the
+    // last field.
+    template <size_t Min, size_t Max>
+    struct Tokens
+    {
+        static_assert(Min >= 1 && Min <= Max && Max <= kMaxRecordTokens, "Tokens<Min, Max> needs 1 <= Min <= Max <= kMaxRecordTokens");
+        static constexpr bool kInt = false;
+        static constexpr bool kFloat = false;
+        static constexpr bool kEndsLine = true;
+        static constexpr size_t kMin = Min;
+        static constexpr size_t kMax = Max;
+    };
+
+    template <typename... Fields>
+    constexpr bool OnlyLastEndsLine()
+    {
+        constexpr bool endsLine[] = { Fields::kEndsLine... };
+        for (size_t i = 0; i + 1 < sizeof...(Fields); ++i)
+        {
+            if (endsLine[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename... Fields, size_t... I>
+    constexpr RecordShapeRule ShapeRuleOf(std::index_sequence<I...>)
+    {
+        using Last = std::tuple_element_t<sizeof...(Fields) - 1, std::tuple<Fields...>>;
+        const size_t count = sizeof...(Fields);
+        const uint32_t intMask = ((Fields::kInt ? 1u << I : 0u) | ...);
+        const uint32_t floatMask = ((Fields::kFloat ? 1u << I : 0u) | ...);
+
+        if constexpr (Last::kEndsLine)
+        {
+            return { count - 1 + Last::kMin, count - 1 + Last::kMax, intMask, floatMask };
+        }
+        else
+        {
+            return { count, kMaxRecordTokens + 1, intMask, floatMask };
+        }
+    }
+}
+
+// Validates a data file line against a fixed list of fields, in order.
+// Tokens after the last field are ignored like sscanf does, unless the last
+// field is a Tokens<> range. The first field is the record key.
+template <typename... Fields>
+class CRecordSchema
+{
+public:
+    static constexpr size_t kFieldCount = sizeof...(Fields);
+    using Values = std::array<std::string_view, kFieldCount>;
+
+    static_assert(kFieldCount > 0 && kFieldCount <= kMaxRecordTokens, "a record schema needs 1 to kMaxRecordTokens fields");
+    static_assert(RecordField::OnlyLastEndsLine<Fields...>(), "Tokens<> has to be the last field");
+
+    static constexpr RecordShapeRule kShapeRule = RecordField::ShapeRuleOf<Fields...>(std::index_sequence_for<Fields...>());
+
+    static bool Matches(const CRecordLine& line)
+    {
+        return kShapeRule.Matches(line.GetShape());
+    }
+
+    // On success record holds the text of every field, pointing into the
+    // line's text.
+    static bool Match(const CRecordLine& line, Values& record)
+    {
+        if (!Matches(line))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i + 1 < kFieldCount; ++i)
+        {
+            record[i] = line.GetToken(i);
+        }
+
+        const std::string_view last = line.GetToken(kFieldCount - 1);
+        if constexpr (LastField::kEndsLine)
+        {
+            const std::string_view end = line.GetToken(line.GetShape().count - 1);
+            record[kFieldCount - 1] = std::string_view(last.data(), static_cast<size_t>(end.data() - last.data()) + end.size());
+        }
+        else
+        {
+            record[kFieldCount - 1] = last;
+        }
+        return true;
+    }
+
+    static bool Matches(std::string_view text)
+    {
+        return Matches(CRecordLine(text));
+    }
+
+    static std::string_view Key(std::string_view text)
+    {
+        size_t offset = 0;
+        return RecordText::NextToken(text, offset);
+    }
+
+private:
+    using LastField = std::tuple_element_t<kFieldCount - 1, std::tuple<Fields...>>;
+};
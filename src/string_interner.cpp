@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "string_interner.h"
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    constexpr size_t kChunkSize = 16 * 1024;
+}
+
+CStringArena::CStringArena(CStringArena&& other) noexcept
+    : chunks(std::move(other.chunks)), openChunk(std::exchange(other.openChunk, nullptr)), chunkUsed(std::exchange(other.chunkUsed, 0))
+{
+}
+
+CStringArena& CStringArena::operator=(CStringArena&& other) noexcept
+{
+    if (this != &other)
+    {
+        chunks = std::move(other.chunks);
+        openChunk = std::exchange(other.openChunk, nullptr);
+        chunkUsed = std::exchange(other.chunkUsed, 0);
+    }
+    return *this;
+}
+
+std::string_view CStringArena::Store(std::string_view text)
+{
+    if (text.empty())
+    {
+        return {};
+    }
+
+    // Long strings get a chunk of their own so the open one is not wasted.
+    if (text.size() > kChunkSize / 4)
+    {
+        chunks.push_back(std::make_unique<char[]>(text.size()));
+        std::memcpy(chunks.back().get(), text.data(), text.size());
+        return std::string_view(chunks.back().get(), text.size());
+    }
+
+    if (!openChunk || kChunkSize - chunkUsed < text.size())
+    {
+        chunks.push_back(std::make_unique<char[]>(kChunkSize));
+        openChunk = chunks.back().get();
+        chunkUsed = 0;
+    }
+
+    char* stored = openChunk + chunkUsed;
+    std::memcpy(stored, text.data(), text.size());
+    chunkUsed += text.size();
+    return std::string_view(stored, text.size());
+}
+
+CStringInterner::Id CStringInterner::Intern(std::string_view text)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(text);
+        if (it != ids.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // Another thread may have added it between the two locks.
+    auto it = ids.find(text);
+    if (it != ids.end())
+    {
+        return it->second;
+    }
+
+    const Id id = static_cast<Id>(strings.size());
+    const std::string_view stored = arena.Store(text);
+    strings.push_back(stored);
+    ids.emplace(stored, id);
+    return id;
+}
+
+bool CStringInterner::Find(std::string_view text, Id& id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(text);
+    if (it == ids.end())
+    {
+        return false;
+    }
+
+    id = it->second;
+    return true;
+}
+
+std::string_view CStringInterner::GetString(Id id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings[id];
+}
+
+size_t CStringInterner::GetCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings.size();
+}
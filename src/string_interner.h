@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Append-only storage for strings that have to outlive the buffer they were
+// read from. Text is copied into 16 KiB chunks; a stored view stays valid for
+// the arena's lifetime, including after the arena is moved. Not thread-safe.
+class CStringArena
+{
+public:
+    CStringArena() = default;
+    CStringArena(CStringArena&& other) noexcept;
+    CStringArena& operator=(CStringArena&& other) noexcept;
+
+    std::string_view Store(std::string_view text);
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* openChunk = nullptr;
+    size_t chunkUsed = 0;
+};
+
+// Hands out one 32-bit id per distinct string, so repeated names are stored
+// once and compared as integers. The interned text lives in chunks owned by
+// the interner and stays valid for its lifetime. Safe to use from several
+// threads; names that are already known only take a shared lock.
+class CStringInterner
+{
+public:
+    using Id = uint32_t;
+
+    Id Intern(std::string_view text);
+    // Returns false and leaves id alone when the text was never interned.
+    bool Find(std::string_view text, Id& id) const;
+    std::string_view GetString(Id id) const;
+    size_t GetCount() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    CStringArena arena;
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, Id> ids;
+};
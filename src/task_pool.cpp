@@ -0,0 +1,331 @@
+#include "pch.h"
+#include "task_pool.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+CTaskPool TaskPool;
+
+namespace
+{
+    thread_local const void* tlsPool = nullptr;
+    thread_local size_t tlsQueue = 0;
+    // Tasks running on this thread; Wait() may run one inside another.
+    thread_local size_t tlsTaskDepth = 0;
+}
+
+struct CTaskPool::State
+{
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Queue 0 belongs to threads outside the pool, worker N uses queue N.
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> pending{ 0 };
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    size_t workerCount = 0;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    bool TryPop(size_t self, std::function<void()>& task)
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.tasks.empty())
+        {
+            return false;
+        }
+
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        --queued;
+        return true;
+    }
+
+    bool TrySteal(size_t self, std::function<void()>& task)
+    {
+        for (size_t offset = 1; offset < queues.size(); ++offset)
+        {
+            Queue& victim = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty())
+            {
+                continue;
+            }
+
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool RunOne(size_t self)
+    {
+        std::function<void()> task;
+        if (!TryPop(self, task) && !TrySteal(self, task))
+        {
+            return false;
+        }
+
+        ++tlsTaskDepth;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            // Kept for Wait(); a throwing task must not leave it hanging on its count.
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+        --tlsTaskDepth;
+
+        if (--pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wake.notify_all();
+        }
+        return true;
+    }
+};
+
+void CTaskPool::WorkerLoop(std::shared_ptr<State> state, size_t index)
+{
+    tlsPool = state.get();
+    tlsQueue = index;
+
+    while (!state->stopping)
+    {
+        if (state->RunOne(index))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(state->wakeMutex);
+        state->wake.wait_for(lock, std::chrono::milliseconds(10), [&state]()
+            {
+                return state->stopping || state->queued > 0;
+            });
+    }
+}
+
+CTaskPool::~CTaskPool()
+{
+    try
+    {
+        Stop();
+    }
+    catch (...)
+    {
+        // Nobody is left to report a failure to at exit.
+    }
+}
+
+void CTaskPool::Start(size_t workerCount)
+{
+    Stop();
+
+    state = std::make_shared<State>();
+    state->workerCount = workerCount;
+    for (size_t i = 0; i <= workerCount; ++i)
+    {
+        state->queues.push_back(std::make_unique<State::Queue>());
+    }
+
+    // Workers are detached and share ownership of the state, so stopping the
+    // pool never has to join a thread that may still be waiting to start.
+    for (size_t i = 1; i <= workerCount; ++i)
+    {
+        std::thread(&CTaskPool::WorkerLoop, state, i).detach();
+    }
+}
+
+void CTaskPool::Stop()
+{
+    if (!state)
+    {
+        return;
+    }
+
+    std::exception_ptr error;
+    try
+    {
+        Wait();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->wakeMutex);
+        state->stopping = true;
+    }
+    state->wake.notify_all();
+    state.reset();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+size_t CTaskPool::GetWorkerCount() const
+{
+    return state ? state->workerCount : 0;
+}
+
+void CTaskPool::Submit(std::function<void()> task)
+{
+    if (!state)
+    {
+        Start(0);
+    }
+
+    const size_t self = tlsPool == state.get() ? tlsQueue : 0;
+    ++state->pending;
+    {
+        std::lock_guard<std::mutex> lock(state->queues[self]->mutex);
+        state->queues[self]->tasks.push_back(std::move(task));
+        ++state->queued;
+    }
+    state->wake.notify_one();
+}
+
+void CTaskPool::Wait()
+{
+    if (!state)
+    {
+        return;
+    }
+
+    // The calling task counts as pending itself, this would never return.
+    assert(tlsTaskDepth == 0 && "CTaskPool::Wait() called from inside a task, use a CTaskGroup");
+
+    RunUntil(state->pending);
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(state->errorMutex);
+        error = std::exchange(state->error, nullptr);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void CTaskPool::RunUntil(const std::atomic<size_t>& pending)
+{
+    if (!state)
+    {
+        return;
+    }
+
+    const size_t self = tlsPool == state.get() ? tlsQueue : 0;
+    while (pending > 0)
+    {
+        if (state->RunOne(self))
+        {
+            continue;
+        }
+
+        // Other threads are still running tasks that may submit more work.
+        std::unique_lock<std::mutex> lock(state->wakeMutex);
+        state->wake.wait_for(lock, std::chrono::milliseconds(1), [this, &pending]()
+            {
+                return pending == 0 || state->queued > 0;
+            });
+    }
+}
+
+void CTaskPool::WakeWaiters()
+{
+    if (!state)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state->wakeMutex);
+    state->wake.notify_all();
+}
+
+CTaskGroup::CTaskGroup(CTaskPool& pool)
+    : pool(pool)
+{
+}
+
+CTaskGroup::~CTaskGroup()
+{
+    try
+    {
+        Wait();
+    }
+    catch (...)
+    {
+        // Only reached when the owner never waited, usually because it is
+        // already leaving through an exception of its own.
+    }
+}
+
+void CTaskGroup::Submit(std::function<void()> task)
+{
+    ++pending;
+    // The group may be gone as soon as pending drops to 0, so the pool is
+    // captured on its own.
+    CTaskPool* owner = &pool;
+    pool.Submit([this, owner, task = std::move(task)]()
+        {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            if (--pending == 0)
+            {
+                owner->WakeWaiters();
+            }
+        });
+}
+
+void CTaskGroup::Wait()
+{
+    pool.RunUntil(pending);
+
+    std::exception_ptr first;
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        first = std::exchange(error, nullptr);
+    }
+    if (first)
+    {
+        std::rethrow_exception(first);
+    }
+}
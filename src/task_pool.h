@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+class CTaskPool;
+
+// Tasks submitted to a pool that can be waited for on their own. Unlike
+// CTaskPool::Wait(), which waits for the whole pool and so for the task
+// calling it, Wait() here may be called from inside a running task: it runs
+// queued tasks of any group until its own are done. The destructor waits as
+// well, tasks may keep references to the group and to the caller's locals.
+class CTaskGroup
+{
+public:
+    explicit CTaskGroup(CTaskPool& pool);
+    ~CTaskGroup();
+
+    CTaskGroup(const CTaskGroup&) = delete;
+    CTaskGroup& operator=(const CTaskGroup&) = delete;
+
+    // Safe to call from inside a running task, including one of this group.
+    void Submit(std::function<void()> task);
+
+    // Returns once every task submitted to this group has finished. The first
+    // exception one of them threw since the last Wait() is rethrown here.
+    void Wait();
+
+private:
+    CTaskPool& pool;
+    std::atomic<size_t> pending{ 0 };
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+// Work-stealing task pool. Each worker owns a deque: it pops its own tasks
+// from the back and steals from the front of the others. Wait() makes the
+// calling thread work through the queues as well, so every submitted task
+// completes even when no worker thread ever gets to run. That matters in
+// DllMain, where new threads stay blocked on the loader lock until the
+// plugin returns.
+class CTaskPool
+{
+public:
+    ~CTaskPool();
+
+    // workerCount == 0 runs every task on the thread calling Wait().
+    void Start(size_t workerCount);
+    // Rethrows like Wait(), after the pool has been stopped.
+    void Stop();
+    size_t GetWorkerCount() const;
+
+    // Safe to call from inside a running task.
+    void Submit(std::function<void()> task);
+
+    // Runs queued tasks on the calling thread until every submitted task,
+    // including the ones submitted by other tasks, has finished. A task that
+    // throws does not stop the others; the first exception since the last
+    // Wait() is rethrown here once they are done. Never call this, or Stop(),
+    // from inside a task: the pool would wait for the caller itself. Tasks
+    // wait through a CTaskGroup or ParallelFor() instead.
+    void Wait();
+
+    // Runs fn(0) .. fn(count - 1) on the pool and returns once all of them
+    // are done. Waits for these calls only, so tasks may use it as well.
+    template<class Fn>
+    void ParallelFor(size_t count, Fn&& fn)
+    {
+        CTaskGroup group(*this);
+        for (size_t i = 0; i < count; ++i)
+        {
+            group.Submit([&fn, i]() { fn(i); });
+        }
+        group.Wait();
+    }
+
+private:
+    friend class CTaskGroup;
+
+    struct State;
+    static void WorkerLoop(std::shared_ptr<State> state, size_t index);
+    // Runs queued tasks on the calling thread until pending drops to 0.
+    void RunUntil(const std::atomic<size_t>& pending);
+    void WakeWaiters();
+
+    std::shared_ptr<State> state;
+};
+
+extern CTaskPool TaskPool;
@@ -0,0 +1,310 @@
+#include "pch.h"
+#include "text_utils.h"
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TEXT_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXT_SIMD 1
+#endif
+
+namespace
+{
+    bool IsSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+    char LowerChar(char ch)
+    {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch + ('a' - 'A')) : ch;
+    }
+
+    char UpperChar(char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - ('a' - 'A')) : ch;
+    }
+
+#if defined(__AVX2__)
+    using Vector = __m256i;
+    constexpr size_t kWidth = 32;
+    constexpr uint32_t kFullMask = 0xFFFFFFFFu;
+
+    Vector Load(const char* data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+    void Store(char* data, Vector value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), value); }
+    Vector Splat(char ch) { return _mm256_set1_epi8(ch); }
+    Vector Equal(Vector left, Vector right) { return _mm256_cmpeq_epi8(left, right); }
+    Vector Greater(Vector left, Vector right) { return _mm256_cmpgt_epi8(left, right); }
+    Vector Or(Vector left, Vector right) { return _mm256_or_si256(left, right); }
+    Vector And(Vector left, Vector right) { return _mm256_and_si256(left, right); }
+    Vector Xor(Vector left, Vector right) { return _mm256_xor_si256(left, right); }
+    Vector Add(Vector left, Vector right) { return _mm256_add_epi8(left, right); }
+    uint32_t Mask(Vector value) { return static_cast<uint32_t>(_mm256_movemask_epi8(value)); }
+#elif defined(TEXT_SIMD)
+    using Vector = __m128i;
+    constexpr size_t kWidth = 16;
+    constexpr uint32_t kFullMask = 0xFFFFu;
+
+    Vector Load(const char* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+    void Store(char* data, Vector value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(data), value); }
+    Vector Splat(char ch) { return _mm_set1_epi8(ch); }
+    Vector Equal(Vector left, Vector right) { return _mm_cmpeq_epi8(left, right); }
+    Vector Greater(Vector left, Vector right) { return _mm_cmpgt_epi8(left, right); }
+    Vector Or(Vector left, Vector right) { return _mm_or_si128(left, right); }
+    Vector And(Vector left, Vector right) { return _mm_and_si128(left, right); }
+    Vector Xor(Vector left, Vector right) { return _mm_xor_si128(left, right); }
+    Vector Add(Vector left, Vector right) { return _mm_add_epi8(left, right); }
+    uint32_t Mask(Vector value) { return static_cast<uint32_t>(_mm_movemask_epi8(value)); }
+#endif
+
+#ifdef TEXT_SIMD
+    uint32_t SpaceMask(Vector block)
+    {
+        const Vector spaces = Or(Equal(block, Splat(' ')), Equal(block, Splat('\t')));
+        const Vector breaks = Or(Equal(block, Splat('\r')), Equal(block, Splat('\n')));
+        return Mask(Or(spaces, breaks));
+    }
+
+    // Lanes holding first..first+25. Shifting first down to -128 turns the
+    // unsigned range test into one signed compare, which is all SSE2 has.
+    Vector LetterMask(Vector block, char first)
+    {
+        const Vector shifted = Add(block, Splat(static_cast<char>(0x80 - static_cast<unsigned char>(first))));
+        return Greater(Splat(static_cast<char>(-128 + 26)), shifted);
+    }
+
+    // Upper and lower case ASCII letters differ only in bit 0x20.
+    Vector FlipCase(Vector block, char first)
+    {
+        return Xor(block, And(LetterMask(block, first), Splat(0x20)));
+    }
+#endif
+}
+
+namespace Text
+{
+    size_t FindFirstNonSpace(std::string_view text, size_t from)
+    {
+        size_t i = from;
+        // Most text starts right away; only runs of blanks are worth the vectors.
+        if (i < text.size() && !IsSpace(text[i]))
+        {
+            return i;
+        }
+
+#ifdef TEXT_SIMD
+        for (; i + kWidth <= text.size(); i += kWidth)
+        {
+            const uint32_t content = ~SpaceMask(Load(text.data() + i)) & kFullMask;
+            if (content != 0)
+            {
+                return i + static_cast<size_t>(std::countr_zero(content));
+            }
+        }
+#endif
+
+        for (; i < text.size(); ++i)
+        {
+            if (!IsSpace(text[i]))
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    size_t FindLastNonSpace(std::string_view text)
+    {
+        size_t end = text.size();
+        if (end > 0 && !IsSpace(text[end - 1]))
+        {
+            return end - 1;
+        }
+
+#ifdef TEXT_SIMD
+        for (; end >= kWidth; end -= kWidth)
+        {
+            const uint32_t content = ~SpaceMask(Load(text.data() + end - kWidth)) & kFullMask;
+            if (content != 0)
+            {
+                return end - kWidth + static_cast<size_t>(31 - std::countl_zero(content));
+            }
+        }
+#endif
+
+        while (end > 0)
+        {
+            --end;
+            if (!IsSpace(text[end]))
+            {
+                return end;
+            }
+        }
+        return npos;
+    }
+
+    size_t FindChar(std::string_view text, char ch, size_t from)
+    {
+        size_t i = from;
+#ifdef TEXT_SIMD
+        const Vector wanted = Splat(ch);
+        for (; i + kWidth <= text.size(); i += kWidth)
+        {
+            const uint32_t hits = Mask(Equal(Load(text.data() + i), wanted));
+            if (hits != 0)
+            {
+                return i + static_cast<size_t>(std::countr_zero(hits));
+            }
+        }
+#endif
+
+        for (; i < text.size(); ++i)
+        {
+            if (text[i] == ch)
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    std::string_view Trim(std::string_view text)
+    {
+        const size_t first = FindFirstNonSpace(text);
+        if (first == npos)
+        {
+            return {};
+        }
+        return text.substr(first, FindLastNonSpace(text) - first + 1);
+    }
+
+    std::string_view TrimLeft(std::string_view text)
+    {
+        const size_t first = FindFirstNonSpace(text);
+        return first == npos ? std::string_view() : text.substr(first);
+    }
+
+    std::string_view TrimRight(std::string_view text)
+    {
+        const size_t last = FindLastNonSpace(text);
+        return last == npos ? std::string_view() : text.substr(0, last + 1);
+    }
+
+    std::vector<std::string_view> SplitTrimmed(std::string_view text, char separator)
+    {
+        std::vector<std::string_view> items;
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            size_t end = FindChar(text, separator, start);
+            if (end == npos)
+            {
+                end = text.size();
+            }
+
+            const std::string_view item = Trim(text.substr(start, end - start));
+            if (!item.empty())
+            {
+                items.push_back(item);
+            }
+            start = end + 1;
+        }
+        return items;
+    }
+
+    bool EqualsIgnoreCase(std::string_view left, std::string_view right)
+    {
+        if (left.size() != right.size())
+        {
+            return false;
+        }
+
+        size_t i = 0;
+#ifdef TEXT_SIMD
+        for (; i + kWidth <= left.size(); i += kWidth)
+        {
+            const Vector a = FlipCase(Load(left.data() + i), 'A');
+            const Vector b = FlipCase(Load(right.data() + i), 'A');
+            if (Mask(Equal(a, b)) != kFullMask)
+            {
+                return false;
+            }
+        }
+#endif
+
+        for (; i < left.size(); ++i)
+        {
+            if (LowerChar(left[i]) != LowerChar(right[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool StartsWithIgnoreCase(std::string_view text, std::string_view prefix)
+    {
+        return text.size() >= prefix.size() && EqualsIgnoreCase(text.substr(0, prefix.size()), prefix);
+    }
+
+    void ToLowerInPlace(std::string& text)
+    {
+        size_t i = 0;
+#ifdef TEXT_SIMD
+        for (; i + kWidth <= text.size(); i += kWidth)
+        {
+            Store(&text[i], FlipCase(Load(text.data() + i), 'A'));
+        }
+#endif
+
+        for (; i < text.size(); ++i)
+        {
+            text[i] = LowerChar(text[i]);
+        }
+    }
+
+    void ToUpperInPlace(std::string& text)
+    {
+        size_t i = 0;
+#ifdef TEXT_SIMD
+        for (; i + kWidth <= text.size(); i += kWidth)
+        {
+            Store(&text[i], FlipCase(Load(text.data() + i), 'a'));
+        }
+#endif
+
+        for (; i < text.size(); ++i)
+        {
+            text[i] = UpperChar(text[i]);
+        }
+    }
+
+    std::string ToLower(std::string_view text)
+    {
+        std::string result(text);
+        ToLowerInPlace(result);
+        return result;
+    }
+
+    std::string ToUpper(std::string_view text)
+    {
+        std::string result(text);
+        ToUpperInPlace(result);
+        return result;
+    }
+
+    bool IsCommentOrEmpty(std::string_view line)
+    {
+        const size_t first = FindFirstNonSpace(line);
+        if (first == npos)
+        {
+            return true;
+        }
+
+        line.remove_prefix(first);
+        return line.front() == ';' || line.front() == '#' || line.starts_with("//");
+    }
+}
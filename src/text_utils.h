@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Text helpers shared by every loader. Whitespace means ' ', '\t', '\r' and
+// '\n', and case folding is ASCII only. The scans run 16 bytes at a time with
+// SSE2, or 32 with AVX2 when the build enables it, and fall back to plain
+// loops elsewhere.
+namespace Text
+{
+    constexpr size_t npos = std::string_view::npos;
+
+    // npos when there is no such character.
+    size_t FindFirstNonSpace(std::string_view text, size_t from = 0);
+    size_t FindLastNonSpace(std::string_view text);
+    size_t FindChar(std::string_view text, char ch, size_t from = 0);
+
+    std::string_view Trim(std::string_view text);
+    std::string_view TrimLeft(std::string_view text);
+    std::string_view TrimRight(std::string_view text);
+
+    // The trimmed items between separators; empty ones are skipped.
+    std::vector<std::string_view> SplitTrimmed(std::string_view text, char separator);
+
+    bool EqualsIgnoreCase(std::string_view left, std::string_view right);
+    bool StartsWithIgnoreCase(std::string_view text, std::string_view prefix);
+
+    void ToLowerInPlace(std::string& text);
+    void ToUpperInPlace(std::string& text);
+    std::string ToLower(std::string_view text);
+    std::string ToUpper(std::string_view text);
+
+    // Blank, or starting with ';', '#' or "//" after leading whitespace.
+    bool IsCommentOrEmpty(std::string_view line);
+}